@@ -0,0 +1,286 @@
+/*
+ * map_fitter_benchmark.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/MapFitterCore.h>
+#include <map_fitter/TerrainGenerator.h>
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace map_fitter {
+
+//! Resolution of the synthetic maps [m].
+static const double resolution = 0.05;
+
+//! Synthetic reference map with a side length of a number of cells.
+static TerrainParameters terrainParameters(int cells)
+{
+  TerrainParameters parameters;
+  parameters.length = cells * resolution;
+  parameters.resolution = resolution;
+  return parameters;
+}
+
+//! Synthetic template maps with a side length of a number of cells.
+static TemplateParameters templateParameters(int cells)
+{
+  TemplateParameters parameters;
+  parameters.length = cells * resolution;
+  return parameters;
+}
+
+/*!
+ * Gives the benchmarks access to the state of the matching, set up with a synthetic
+ * reference map and a template map extracted from it.
+ */
+class BenchmarkMapFitter : public MapFitterCore
+{
+public:
+    BenchmarkMapFitter(int referenceCells, int templateCells, int correlationIncrement = 5)
+    {
+      MapFitterParameters parameters;
+      parameters.verbose = false;
+      setParameters(parameters);
+
+      TerrainGenerator generator(terrainParameters(referenceCells), templateParameters(templateCells));
+      setReferenceMap(generator.getReferenceMap());
+
+      PriorPose pose;
+      pose.x = 0.3;
+      pose.y = -0.2;
+      generator.extractTemplate(pose, pose, map_);
+      elevation_ = map_.get("elevation");
+      variance_ = map_.get("variance");
+
+      correlationIncrement_ = correlationIncrement;
+      templateRotation_ = 0;
+      map_min_ = elevation_.minCoeffOfFinites();
+      map_max_ = elevation_.maxCoeffOfFinites();
+      reference_min_ = referenceMap_.get("elevation").minCoeffOfFinites();
+      reference_max_ = referenceMap_.get("elevation").maxCoeffOfFinites();
+      referenceMap_.getIndex(map_.getPosition(), templateIndex_);
+    }
+
+    ConstMatrixMap data() const { return ConstMatrixMap(elevation_.data(), elevation_.rows(), elevation_.cols()); }
+    ConstMatrixMap varianceData() const { return ConstMatrixMap(variance_.data(), variance_.rows(), variance_.cols()); }
+    grid_map::LayerView referenceData() const { return grid_map::LayerView(referenceMap_, "elevation"); }
+
+    //! Index of the true position of the template map in the reference map.
+    const grid_map::Index& getTemplateIndex() const { return templateIndex_; }
+
+    /*!
+     * Places random SAD particles around the true position of the template map.
+     */
+    void setRandomParticles(int numberOfParticles, int spread = 40)
+    {
+      std::default_random_engine generator(3);
+      std::uniform_int_distribution<int> offset(-spread, spread);
+      std::uniform_int_distribution<int> theta(0, 359);
+      grid_map::Size size = referenceMap_.getSize();
+      particleRowSAD_.clear(); particleColSAD_.clear(); particleThetaSAD_.clear(); particleCountSAD_.clear();
+      for (int i = 0; i < numberOfParticles; i++)
+      {
+        particleRowSAD_.push_back((templateIndex_(0) + offset(generator) + size(0)) % size(0));
+        particleColSAD_.push_back((templateIndex_(1) + offset(generator) + size(1)) % size(1));
+        particleThetaSAD_.push_back(theta(generator));
+        particleCountSAD_.push_back(1);
+      }
+      numberOfParticles_ = numberOfParticles;
+    }
+
+    //! Random SAD scores below the reinitialization threshold.
+    std::vector<float> randomScores(size_t numberOfScores) const
+    {
+      std::default_random_engine generator(4);
+      std::uniform_real_distribution<float> score(0.0, 0.8 * SADThreshold_);
+      std::vector<float> scores(numberOfScores);
+      for (float& value : scores) { value = score(generator); }
+      return scores;
+    }
+
+    const std::vector<int>& getParticleRows() const { return particleRowSAD_; }
+    const std::vector<int>& getParticleCols() const { return particleColSAD_; }
+    const std::vector<int>& getParticleThetas() const { return particleThetaSAD_; }
+
+    //! Number of particles of all metrics.
+    size_t getNumberOfParticles() const { return particleRowSAD_.size() + particleRowSSD_.size() + particleRowNCC_.size() + particleRowMI_.size(); }
+
+    void setSearchIncrement(int searchIncrement) { searchIncrement_ = searchIncrement; }
+
+private:
+    grid_map::Matrix elevation_;
+    grid_map::Matrix variance_;
+    grid_map::Index templateIndex_;
+};
+
+//! Template sizes [cells].
+static const std::vector<int64_t> templateSizes = {32, 64, 128};
+
+//! Reference sizes [cells].
+static const std::vector<int64_t> referenceSizes = {256, 512};
+
+//! Distances between the compared template cells [cells].
+static const std::vector<int64_t> correlationIncrements = {1, 2, 5};
+
+//! Numbers of particles.
+static const std::vector<int64_t> particleCounts = {1000, 4000, 16000};
+
+/*!
+ * Overlap search of one particle, args: template size, reference size, correlation increment.
+ */
+static void BM_FindMatches(benchmark::State& state)
+{
+  BenchmarkMapFitter fitter(state.range(1), state.range(0), state.range(2));
+  fitter.setRandomParticles(1024);
+  const ConstMatrixMap data = fitter.data();
+  const ConstMatrixMap variance = fitter.varianceData();
+  const grid_map::LayerView reference = fitter.referenceData();
+  size_t i = 0;
+  for (auto _ : state)
+  {
+    float theta = fitter.getParticleThetas()[i] / 180.0 * M_PI;
+    bool success = fitter.findMatches(data, variance, reference, fitter.getParticleRows()[i], fitter.getParticleCols()[i], sin(theta), cos(theta), false);
+    benchmark::DoNotOptimize(success);
+    i = (i + 1) % fitter.getParticleRows().size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindMatches)->ArgsProduct({templateSizes, referenceSizes, correlationIncrements})->ArgNames({"template", "reference", "increment"});
+
+/*!
+ * Score of the overlap at the true position, args: template size, correlation increment.
+ */
+template<float (MapFitterCore::*Metric)()>
+static void BM_Metric(benchmark::State& state)
+{
+  BenchmarkMapFitter fitter(referenceSizes.front(), state.range(0), state.range(1));
+  const grid_map::Index& index = fitter.getTemplateIndex();
+  if (!fitter.findMatches(fitter.data(), fitter.varianceData(), fitter.referenceData(), index(0), index(1), 0.0, 1.0, false))
+  {
+    state.SkipWithError("No overlap.");
+    return;
+  }
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize((fitter.*Metric)());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+#define METRIC_BENCHMARK(metric) \
+  BENCHMARK_TEMPLATE(BM_Metric, &MapFitterCore::metric)->Name("BM_" #metric)->ArgsProduct({templateSizes, correlationIncrements})->ArgNames({"template", "increment"})
+METRIC_BENCHMARK(errorSAD);
+METRIC_BENCHMARK(weightedErrorSAD);
+METRIC_BENCHMARK(errorSSD);
+METRIC_BENCHMARK(weightedErrorSSD);
+METRIC_BENCHMARK(correlationNCC);
+METRIC_BENCHMARK(weightedCorrelationNCC);
+METRIC_BENCHMARK(mutualInformation);
+METRIC_BENCHMARK(normalizedMutualInformation);
+
+/*!
+ * Height offset of the best particle, args: template size, reference size.
+ */
+static void BM_FindZ(benchmark::State& state)
+{
+  BenchmarkMapFitter fitter(state.range(1), state.range(0));
+  const ConstMatrixMap data = fitter.data();
+  const grid_map::LayerView reference = fitter.referenceData();
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(fitter.findZ(data, reference, 0.3, -0.2, 0));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindZ)->ArgsProduct({templateSizes, referenceSizes})->ArgNames({"template", "reference"});
+
+/*!
+ * Best particle of a metric, args: number of particles.
+ */
+static void BM_FindBestPos(benchmark::State& state)
+{
+  BenchmarkMapFitter fitter(referenceSizes.front(), templateSizes.front());
+  fitter.setRandomParticles(state.range(0));
+  std::vector<float> scores = fitter.randomScores(state.range(0));
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(fitter.findBestPos("SAD", scores, 1));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FindBestPos)->ArgsProduct({particleCounts})->ArgNames({"particles"});
+
+/*!
+ * Resampling of a metric, args: number of particles.
+ */
+static void BM_Resample(benchmark::State& state)
+{
+  BenchmarkMapFitter fitter(referenceSizes.front(), templateSizes.front());
+  std::normal_distribution<float> distribution(0.0, 2.0);
+  std::vector<float> scores = fitter.randomScores(state.range(0));
+  fitter.setRandomParticles(state.range(0));
+  std::vector<float> bestPos = fitter.findBestPos("SAD", scores, 1);
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    fitter.setRandomParticles(state.range(0));
+    state.ResumeTiming();
+    fitter.resample("SAD", bestPos, scores, distribution, 1);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Resample)->ArgsProduct({particleCounts})->ArgNames({"particles"})->Unit(benchmark::kMicrosecond);
+
+/*!
+ * Initialization of the particles of all metrics, args: reference size, search increment.
+ */
+static void BM_InitializeParticles(benchmark::State& state)
+{
+  BenchmarkMapFitter fitter(state.range(0), templateSizes.front());
+  fitter.setSearchIncrement(state.range(1));
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    fitter.reset();
+    state.ResumeTiming();
+    fitter.initializeParticles(1);
+  }
+  state.counters["particles"] = fitter.getNumberOfParticles();
+  state.SetItemsProcessed(state.iterations() * fitter.getNumberOfParticles());
+}
+BENCHMARK(BM_InitializeParticles)->ArgsProduct({referenceSizes, {2, 5}})->ArgNames({"reference", "search"})->Unit(benchmark::kMillisecond);
+
+/*!
+ * Matching of a stream of template maps along a trajectory after the initialization,
+ * args: template size, number of particles.
+ */
+static void BM_MatchStream(benchmark::State& state)
+{
+  MapFitterParameters parameters;
+  parameters.verbose = false;
+  parameters.numberOfParticles = state.range(1);
+  MapFitterCore core(parameters);
+  TerrainGenerator generator(terrainParameters(referenceSizes.front()), templateParameters(state.range(0)));
+  core.setReferenceMap(generator.getReferenceMap());
+
+  std::vector<MatchEstimate> estimates;
+  SyntheticFrame frame = generator.generateFrame(0);
+  core.match(frame.map, frame.prior, estimates);
+  int frameNumber = 1;
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    frame = generator.generateFrame(frameNumber++);
+    state.ResumeTiming();
+    core.match(frame.map, frame.prior, estimates);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MatchStream)->ArgsProduct({{32, 64}, {1000, 4000}})->ArgNames({"template", "particles"})->Unit(benchmark::kMillisecond);
+
+} /* namespace */
+
+BENCHMARK_MAIN();
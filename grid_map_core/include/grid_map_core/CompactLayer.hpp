@@ -0,0 +1,184 @@
+/*
+ * CompactLayer.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#pragma once
+
+#include "grid_map_core/TypeDefs.hpp"
+
+// STL
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// Eigen
+#include <Eigen/Core>
+
+namespace grid_map {
+
+/*!
+ * Storage types of the grid map layers.
+ * - Float32: single precision floats (default).
+ * - Float16: half precision floats (11 bit mantissa, ~3 significant digits).
+ * - ScaledInt16: 16 bit integers with a per-layer scale and offset (fixed resolution).
+ */
+enum class StorageType
+{
+  Float32,
+  Float16,
+  ScaledInt16
+};
+
+/*!
+ * Layer data stored with 16 bits per cell. Cells are converted to float on access,
+ * invalid (non-finite) values are stored as NAN.
+ */
+class CompactLayer
+{
+ public:
+  typedef Eigen::Matrix<uint16_t, Eigen::Dynamic, Eigen::Dynamic> RawMatrix;
+
+  /*!
+   * Constructor.
+   * @param data the data to be stored.
+   * @param type the storage type (Float16 or ScaledInt16).
+   * @param resolution the step size of the ScaledInt16 values, if zero the smallest
+   *        step size that covers the range of the data is used. Values out of the range
+   *        that can be stored with the given step size are clamped.
+   */
+  CompactLayer(const Matrix& data, const StorageType type, const double resolution = 0.0);
+
+  /*!
+   * Destructor.
+   */
+  virtual ~CompactLayer();
+
+  /*!
+   * Get the value of a cell.
+   * @param row the row of the cell.
+   * @param col the column of the cell.
+   * @return the value of the cell (NAN if invalid).
+   */
+  inline float operator()(const int row, const int col) const
+  {
+    const uint16_t value = data_(row, col);
+    if (type_ == StorageType::Float16) return halfToFloat(value);
+    const int16_t scaledValue = static_cast<int16_t>(value);
+    if (scaledValue == invalidValue) return NAN;
+    return offset_ + scale_ * scaledValue;
+  }
+
+  /*!
+   * Sets a block of cells to invalid.
+   * @param row the top row of the block.
+   * @param col the left column of the block.
+   * @param rows the number of rows of the block.
+   * @param cols the number of columns of the block.
+   */
+  void setInvalid(const int row, const int col, const int rows, const int cols);
+
+  /*!
+   * Converts the data to float.
+   * @param[out] data the data as float matrix.
+   */
+  void toMatrix(Matrix& data) const;
+
+  /*!
+   * Get the smallest valid value.
+   * @return the smallest valid value.
+   */
+  float minCoeffOfFinites() const;
+
+  /*!
+   * Get the largest valid value.
+   * @return the largest valid value.
+   */
+  float maxCoeffOfFinites() const;
+
+  /*!
+   * Get the storage type.
+   * @return the storage type.
+   */
+  StorageType getType() const;
+
+  /*!
+   * Get the scale of the ScaledInt16 values.
+   * @return the scale (step size).
+   */
+  float getScale() const;
+
+  /*!
+   * Get the offset of the ScaledInt16 values.
+   * @return the offset.
+   */
+  float getOffset() const;
+
+  /*!
+   * Get the stored 16 bit values.
+   * @return the stored values.
+   */
+  const RawMatrix& getRaw() const;
+
+  int rows() const;
+  int cols() const;
+
+  /*!
+   * Converts a float to a half precision float (rounded to nearest even).
+   * @param value the float value.
+   * @return the half precision float bits.
+   */
+  static uint16_t floatToHalf(const float value);
+
+  /*!
+   * Converts a half precision float to float.
+   * @param value the half precision float bits.
+   * @return the float value.
+   */
+  static inline float halfToFloat(const uint16_t value)
+  {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+      // Inf or NaN.
+      bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+      bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+      bits = sign;
+    } else {
+      // Subnormal, normalize.
+      exponent = 113;
+      while (!(mantissa & 0x400)) {
+        mantissa <<= 1;
+        exponent--;
+      }
+      bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+
+  //! ScaledInt16 value used for invalid cells.
+  static const int16_t invalidValue = INT16_MIN;
+
+ private:
+  //! Storage type.
+  StorageType type_;
+
+  //! Stored values (half precision bits or scaled integers).
+  RawMatrix data_;
+
+  //! Scale of the ScaledInt16 values.
+  float scale_;
+
+  //! Offset of the ScaledInt16 values.
+  float offset_;
+};
+
+} /* namespace */
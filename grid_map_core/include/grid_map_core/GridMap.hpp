@@ -11,10 +11,13 @@
 #include "grid_map_core/TypeDefs.hpp"
 #include "grid_map_core/SubmapGeometry.hpp"
 #include "grid_map_core/BufferRegion.hpp"
+#include "grid_map_core/CompactLayer.hpp"
 
 // STL
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
 
 // Eigen
 #include <Eigen/Core>
@@ -35,6 +38,20 @@ class SubmapGeometry;
  * - "quality"
  * - "surface_normal_x", "surface_normal_y", "surface_normal_z"
  * etc.
+ *
+ * The layers are shared between copies of a grid map (copy-on-write), such that
+ * copies are cheap. The data of a layer is copied on the first non-const access to
+ * it (e.g. `get(...)`, `operator[]`, `at(...)`), const access never copies it. Copies
+ * can be read and modified from different threads, while a single grid map must not
+ * be modified concurrently.
+ * Note: Copying a grid map invalidates the references to its layer data (`get(...)`,
+ * `operator[]`). A reference obtained before the copy still points at the data shared
+ * with the copy, writing through it changes the copy as well. Get the reference again
+ * after copying the map.
+ *
+ * Layers can be stored with reduced precision (see `setStorageType(...)`) to save
+ * memory and bandwidth for large maps that are mostly read. The const `get(...)` returns
+ * a float copy of such a layer.
  */
 class GridMap
 {
@@ -92,7 +109,10 @@ class GridMap
   bool exists(const std::string& layer) const;
 
   /*!
-   * Returns the grid map data for a layer as matrix.
+   * Returns the grid map data for a layer as matrix. A layer stored compactly (see
+   * `setStorageType(...)`) or with cells dropped lazily by `move(...)` (see `setLazyClearing(...)`)
+   * is returned as a float copy, in which the dropped cells are invalid. The copy is kept until the
+   * layer is modified.
    * @param layer the name of the layer to be returned.
    * @return grid map data as matrix.
    * @throw std::out_of_range if no map layer with name `layer` is present.
@@ -101,7 +121,8 @@ class GridMap
 
   /*!
    * Returns the grid map data for a layer as non-const. Use this method
-   * with care!
+   * with care! The data is copied first if it is shared with a copy of the map,
+   * the reference is invalidated when the map is copied.
    * @param layer the name of the layer to be returned.
    * @return grid map data.
    * @throw std::out_of_range if no map layer with name `layer` is present.
@@ -109,7 +130,7 @@ class GridMap
   Matrix& get(const std::string& layer);
 
   /*!
-   * Returns the grid map data for a layer as matrix.
+   * Returns the grid map data for a layer as matrix (see the const `get(...)`).
    * @param layer the name of the layer to be returned.
    * @return grid map data as matrix.
    * @throw std::out_of_range if no map layer with name `layer` is present.
@@ -118,7 +139,8 @@ class GridMap
 
   /*!
    * Returns the grid map data for a layer as non-const. Use this method
-   * with care!
+   * with care! The data is copied first if it is shared with a copy of the map,
+   * the reference is invalidated when the map is copied.
    * @param layer the name of the layer to be returned.
    * @return grid map data.
    * @throw std::out_of_range if no map layer with name `layer` is present.
@@ -132,6 +154,52 @@ class GridMap
    */
   bool erase(const std::string& layer);
 
+  /*!
+   * Set the storage type of a layer. Layers stored as Float16 or ScaledInt16 need half the memory
+   * and are converted to float on access: `at(...)` (const) converts single cells, `getSubmap(...)`
+   * returns float layers and the const `get(...)` a float copy of the layer. Read the entire layer
+   * with `LayerView` or `getCompact(...)` to avoid the copy. Clearing and moving the map keep the
+   * storage type, writing to the layer (non-const `get(...)`, `at(...)`) converts it back to Float32.
+   * @param layer the name of the layer.
+   * @param type the storage type.
+   * @param resolution the step size of the ScaledInt16 values, if zero the smallest
+   *        step size that covers the range of the data is used.
+   * @throw std::out_of_range if no map layer with name `layer` is present.
+   */
+  void setStorageType(const std::string& layer, const StorageType type, const double resolution = 0.0);
+
+  /*!
+   * Gets the storage type of a layer.
+   * @param layer the name of the layer.
+   * @return the storage type of the layer.
+   */
+  StorageType getStorageType(const std::string& layer) const;
+
+  /*!
+   * Returns the compact data of a layer stored as Float16 or ScaledInt16.
+   * Note: Cells dropped by `move(...)` with lazy clearing are only cleared after `flush()`.
+   * @param layer the name of the layer.
+   * @return the compact data of the layer.
+   * @throw std::out_of_range if the layer is not present or not stored compactly.
+   */
+  const CompactLayer& getCompact(const std::string& layer) const;
+
+  /*!
+   * Checks if cells of a layer have been dropped lazily and are not cleared yet (see `setLazyClearing(...)`).
+   * @param layer the name of the layer.
+   * @return true if the layer has pending dropped cells.
+   */
+  bool hasStaleRegions(const std::string& layer) const;
+
+  /*!
+   * Checks if a layer shares its data with the same layer of another grid map (copy-on-write).
+   * Shared layers have not been modified since one of the maps was copied from the other.
+   * @param layer the name of the layer.
+   * @param other the other grid map.
+   * @return true if both maps have the layer and it is shared.
+   */
+  bool isShared(const std::string& layer, const GridMap& other) const;
+
   /*!
    * Gets the names of the layers.
    * @return the names of the layers.
@@ -322,6 +390,30 @@ class GridMap
    */
   bool move(const Position& position);
 
+  /*!
+   * Enables or disables lazy clearing of the cells that are dropped when moving the map.
+   * If enabled, `move(...)` only records the dropped regions of the buffer. The cells of these
+   * regions read as invalid (NAN) through `at(...)`, `atPosition(...)` and `isValid(...)`, and are
+   * cleared when they are written again with `at(...)`, when the layer is accessed non-const as
+   * matrix (`get(...)`, `operator[]`) or on `flush()`. Disabling lazy clearing clears all pending regions.
+   * `getSubmap(...)`, the const `get(...)` and `LayerView` return the dropped cells as invalid without
+   * modifying the map, the const `get(...)` by a copy of the layer: call `flush()` before reading
+   * large layers as matrix through a const reference to avoid the copy.
+   * @param enable true if the dropped cells should be cleared lazily.
+   */
+  void setLazyClearing(const bool enable);
+
+  /*!
+   * Checks if lazy clearing is enabled (see `setLazyClearing(...)`).
+   * @return true if lazy clearing is enabled.
+   */
+  bool isLazyClearing() const;
+
+  /*!
+   * Clears all cells that have been dropped lazily when moving the map.
+   */
+  void flush();
+
   /*!
    * Adds data from an other grid map to this grid map
    * @param other the grid map to take data from.
@@ -414,8 +506,26 @@ class GridMap
    */
   const Size& getSize() const;
 
+  /*!
+   * Gets the smallest submap that contains all valid (non-NAN) cells of a layer.
+   * The data is scanned column by column in storage order. If caching is enabled,
+   * the result is kept until the layer is accessed non-const, the map is moved,
+   * cleared or its geometry changes.
+   * Note: Writes through references to the data that were obtained before the query
+   * are not detected, disable caching when the data is modified this way.
+   * @param[in] layer the layer to be checked for valid cells.
+   * @param[out] startIndex the start index of the submap (top-left), (-1, -1) if the layer has no valid cells.
+   * @param[out] size the size of the submap, zero if the layer has no valid cells.
+   */
   void getDataBoundingSubmap(const std::string& layer, Index& startIndex, Size& size);
 
+  /*!
+   * Enables or disables caching of the data bounding submaps (see `getDataBoundingSubmap(...)`).
+   * Caching is disabled by default.
+   * @param enable true if the data bounding submaps should be cached.
+   */
+  void setDataBoundingSubmapCaching(const bool enable);
+
   /*!
    * Set the start index of the circular buffer.
    * Use this method with caution!
@@ -445,20 +555,122 @@ class GridMap
    */
   void clearRows(unsigned int index, unsigned int nRows);
 
+  /*!
+   * Records a dropped region of the buffer for lazy clearing.
+   * @param region the dropped region.
+   * @param layers the layers to be cleared in this region.
+   */
+  void addStaleRegion(const BufferRegion& region, const std::vector<std::string>& layers);
+
+  /*!
+   * Checks if a cell of a layer has been dropped and is not cleared yet.
+   * @param layer the name of the layer.
+   * @param index the index of the cell.
+   * @return true if the cell is stale.
+   */
+  bool isStale(const std::string& layer, const Index& index) const;
+
+  /*!
+   * Clears the cells of a layer in all pending dropped regions.
+   * @param layer the name of the layer.
+   */
+  void clearStaleRegions(const std::string& layer);
+
+  /*!
+   * Clears the cells of all layers in all pending dropped regions.
+   */
+  void clearStaleRegions();
+
+  /*!
+   * Removes a layer from the pending dropped regions without clearing it.
+   * @param layer the name of the layer.
+   */
+  void removeStaleLayer(const std::string& layer);
+
+  /*!
+   * Clears (sets to NAN) a block of the buffer of a layer. Compact layers are cleared
+   * in their compact form, shared data is copied first (copy-on-write).
+   * @param layer the name of the layer.
+   * @param index the top-left index of the block.
+   * @param size the size of the block.
+   */
+  void clearBlock(const std::string& layer, const Index& index, const Size& size);
+
+  /*!
+   * Removes the cached data bounding submap and read copy of a layer.
+   * @param layer the name of the layer.
+   */
+  void invalidateCaches(const std::string& layer);
+
+  /*!
+   * Removes the cached data bounding submaps and read copies of all layers.
+   */
+  void invalidateCaches();
+
   /*!
    * Resize the buffer.
    * @param bufferSize the requested buffer size.
    */
   void resize(const Index& bufferSize);
 
+  /*!
+   * Copies the data of a layer if it is shared with other grid maps (copy-on-write).
+   * @param data the data of the layer.
+   * @return the data of the layer, owned only by this grid map.
+   */
+  static Matrix& getUnshared(std::shared_ptr<Matrix>& data);
+
+  /*!
+   * Gets the data of a layer for writing. Converts compact layers back to Float32
+   * and copies shared data (copy-on-write).
+   * @param layer the name of the layer.
+   * @return the data of the layer, owned only by this grid map.
+   * @throw std::out_of_range if no map layer with name `layer` is present.
+   */
+  Matrix& getWritable(const std::string& layer);
+
+  /*!
+   * Gets the data of a layer as float matrix without modifying the map.
+   * @param layer the name of the layer.
+   * @param decoded the storage for the converted data of a compact layer.
+   * @return the data of the layer, or `decoded` if the layer is compact.
+   * @throw std::out_of_range if no map layer with name `layer` is present.
+   */
+  const Matrix& getDecoded(const std::string& layer, Matrix& decoded) const;
+
+  /*!
+   * Gets the float copy of a layer that is returned by the const `get(...)`, creates it
+   * on the first call with the lazily dropped cells set to invalid. Safe to be called from several threads.
+   * @param layer the name of the layer.
+   * @return the float copy of the layer.
+   */
+  const Matrix& getReadCopy(const std::string& layer) const;
+
+  /*!
+   * Float copies of layers read through the const `get(...)`, guarded by a mutex.
+   * A copy of the map starts without read copies.
+   */
+  struct ReadCopies
+  {
+    ReadCopies() {}
+    ReadCopies(const ReadCopies&) {}
+    ReadCopies& operator=(const ReadCopies&) { layers.clear(); return *this; }
+    std::mutex mutex;
+    std::unordered_map<std::string, Matrix> layers;
+  };
+
   //! Frame id of the grid map.
   std::string frameId_;
 
   //! Timestamp of the grid map (nanoseconds).
   Time timestamp_;
 
-  //! Grid map data stored as layers of matrices.
-  std::unordered_map<std::string, Matrix> data_;
+  //! Grid map data stored as layers of matrices, shared between copies of the map.
+  //! The data of compact layers is empty until they are written.
+  std::unordered_map<std::string, std::shared_ptr<Matrix>> data_;
+
+  //! Layers stored with reduced precision, shared between copies of the map.
+  std::unordered_map<std::string, std::shared_ptr<CompactLayer>> compactData_;
 
   //! Names of the data layers.
   std::vector<std::string> layers_;
@@ -482,6 +694,21 @@ class GridMap
 
   //! Circular buffer start indeces.
   Index startIndex_;
+
+  //! True if the cells dropped when moving the map are cleared lazily.
+  bool isLazyClearing_;
+
+  //! Dropped regions of the buffer that are not cleared yet, with the layers to be cleared.
+  std::vector<std::pair<BufferRegion, std::vector<std::string>>> staleRegions_;
+
+  //! True if the data bounding submaps are cached.
+  bool cacheDataBoundingSubmaps_;
+
+  //! Cached data bounding submaps for the layers.
+  std::unordered_map<std::string, BufferRegion> dataBoundingSubmaps_;
+
+  //! Float copies of the layers that can not be returned directly by the const `get(...)`.
+  mutable ReadCopies readCopies_;
 };
 
 } /* namespace */
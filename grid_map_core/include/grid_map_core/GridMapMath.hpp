@@ -200,6 +200,46 @@ bool getBufferRegionsForSubmap(std::vector<BufferRegion>& submapBufferRegions,
                                const Size& bufferSize,
                                const Index& bufferStartIndex = Index::Zero());
 
+/*!
+ * Splits the regions in the circular buffer that make up a submap further into
+ * blocks of rows. Every span is contiguous in the buffer (i.e. can be accessed as
+ * a block of the data matrix) and can be processed independently of the others.
+ * @param[out] spans the list of buffer regions that make up the submap.
+ * @param[in] submapIndex the index (top-left) for the requested submap.
+ * @param[in] submapBufferSize the size of the requested submap.
+ * @param[in] bufferSize the buffer size of the map.
+ * @param[in] bufferStartIndex the index of the starting point of the circular buffer.
+ * @param[in] nBlocks the number of blocks the submap is split into (approximately).
+ * @return true if successful, false if requested submap is not fully contained in the map.
+ */
+bool getBufferSpansForSubmap(std::vector<BufferRegion>& spans,
+                             const Index& submapIndex,
+                             const Size& submapBufferSize,
+                             const Size& bufferSize,
+                             const Index& bufferStartIndex,
+                             const unsigned int nBlocks);
+
+/*!
+ * Splits a submap into blocks of consecutive rows. The blocks keep the (row-major)
+ * iteration order of the submap and start at multiples of `every` rows, such that a
+ * sparse iteration over all blocks visits the same cells as over the entire submap.
+ * Note: The blocks may wrap around the circular buffer, use them with iterators.
+ * @param[out] blocks the row blocks (start index in the buffer and size), in iteration order.
+ * @param[in] submapIndex the index (top-left) for the requested submap.
+ * @param[in] submapBufferSize the size of the requested submap.
+ * @param[in] bufferSize the buffer size of the map.
+ * @param[in] bufferStartIndex the index of the starting point of the circular buffer.
+ * @param[in] nBlocks the maximum number of blocks.
+ * @param[in] every the step size of a sparse iteration (optional).
+ */
+void getRowBlocksForSubmap(std::vector<BufferRegion>& blocks,
+                           const Index& submapIndex,
+                           const Size& submapBufferSize,
+                           const Size& bufferSize,
+                           const Index& bufferStartIndex,
+                           const unsigned int nBlocks,
+                           const int every = 1);
+
 /*!
  * Increases the index by one to iterate through the map.
  * Increments either to the neighboring index to the right or to
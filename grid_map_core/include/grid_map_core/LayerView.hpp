@@ -0,0 +1,72 @@
+/*
+ * LayerView.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#pragma once
+
+#include "grid_map_core/TypeDefs.hpp"
+#include "grid_map_core/GridMap.hpp"
+#include "grid_map_core/CompactLayer.hpp"
+
+namespace grid_map {
+
+/*!
+ * Read-only access to the data of a layer for any storage type. Compact layers are
+ * read in their compact form, such that bulk reads need less memory bandwidth.
+ * Cells dropped lazily by `GridMap::move(...)` read as invalid, a layer with such
+ * cells is read from the float copy of the const `GridMap::get(...)`.
+ * The view is valid as long as the layer is not modified.
+ */
+class LayerView
+{
+ public:
+  /*!
+   * Constructor.
+   * @param gridMap the grid map.
+   * @param layer the name of the layer.
+   * @throw std::out_of_range if no map layer with name `layer` is present.
+   */
+  LayerView(const GridMap& gridMap, const std::string& layer);
+
+  /*!
+   * Get the value of a cell.
+   * @param row the row of the cell (buffer index).
+   * @param col the column of the cell (buffer index).
+   * @return the value of the cell.
+   */
+  inline float operator()(const int row, const int col) const
+  {
+    if (compact_ == nullptr) return (*data_)(row, col);
+    return (*compact_)(row, col);
+  }
+
+  /*!
+   * Get the smallest valid value.
+   * @return the smallest valid value.
+   */
+  float minCoeffOfFinites() const;
+
+  /*!
+   * Get the largest valid value.
+   * @return the largest valid value.
+   */
+  float maxCoeffOfFinites() const;
+
+  /*!
+   * Get the storage type of the layer.
+   * @return the storage type.
+   */
+  StorageType getStorageType() const;
+
+ private:
+  //! Float data (if the layer is not compact).
+  const Matrix* data_;
+
+  //! Compact data (if the layer is compact).
+  const CompactLayer* compact_;
+};
+
+} /* namespace */
@@ -0,0 +1,68 @@
+/*
+ * ParallelFor.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#pragma once
+
+#include "grid_map_core/TypeDefs.hpp"
+#include "grid_map_core/GridMap.hpp"
+#include "grid_map_core/BufferRegion.hpp"
+#include "grid_map_core/ThreadPool.hpp"
+
+// STL
+#include <functional>
+
+namespace grid_map {
+
+/*!
+ * Runs a function on the spans of a submap in parallel. Every span is a block of
+ * rows that is contiguous in the circular buffer, so the function can work on
+ * `matrix.block(startIndex(0), startIndex(1), size(0), size(1))` directly.
+ * The function must only write to cells within its span.
+ * @param gridMap the grid map to iterate on.
+ * @param submapStartIndex the start index of the submap, typically top-left index.
+ * @param submapSize the size of the submap.
+ * @param function the function to run for each span.
+ * @param threadPool the thread pool to run on (optional).
+ * @return true if successful, false if the submap is not fully contained in the map.
+ */
+bool parallelForEachSpan(const GridMap& gridMap, const Index& submapStartIndex, const Size& submapSize,
+                         const std::function<void(const BufferRegion&)>& function,
+                         ThreadPool& threadPool = ThreadPool::getDefault());
+
+/*!
+ * Runs a function on the spans of the entire map in parallel (see above).
+ * @param gridMap the grid map to iterate on.
+ * @param function the function to run for each span.
+ * @param threadPool the thread pool to run on (optional).
+ */
+void parallelForEachSpan(const GridMap& gridMap, const std::function<void(const BufferRegion&)>& function,
+                         ThreadPool& threadPool = ThreadPool::getDefault());
+
+/*!
+ * Runs a function for every cell of a submap in parallel. The order in which the
+ * cells are visited is undefined. The function must only write to the cell it is called for.
+ * @param gridMap the grid map to iterate on.
+ * @param submapStartIndex the start index of the submap, typically top-left index.
+ * @param submapSize the size of the submap.
+ * @param function the function to run for each cell (with the buffer index of the cell).
+ * @param threadPool the thread pool to run on (optional).
+ * @return true if successful, false if the submap is not fully contained in the map.
+ */
+bool parallelForEachCell(const GridMap& gridMap, const Index& submapStartIndex, const Size& submapSize,
+                         const std::function<void(const Index&)>& function,
+                         ThreadPool& threadPool = ThreadPool::getDefault());
+
+/*!
+ * Runs a function for every cell of the entire map in parallel (see above).
+ * @param gridMap the grid map to iterate on.
+ * @param function the function to run for each cell (with the buffer index of the cell).
+ * @param threadPool the thread pool to run on (optional).
+ */
+void parallelForEachCell(const GridMap& gridMap, const std::function<void(const Index&)>& function,
+                         ThreadPool& threadPool = ThreadPool::getDefault());
+
+} /* namespace */
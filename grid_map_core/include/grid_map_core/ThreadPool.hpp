@@ -0,0 +1,111 @@
+/*
+ * ThreadPool.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#pragma once
+
+// STL
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+namespace grid_map {
+
+/*!
+ * Fixed size pool of worker threads to run independent tasks in parallel.
+ * The calling thread takes part in the work, i.e. a pool with `n` threads
+ * owns `n - 1` workers. Only one parallel loop runs on a pool at a time,
+ * nested or concurrent calls fall back to serial execution.
+ */
+class ThreadPool
+{
+ public:
+  /*!
+   * Constructor.
+   * @param nThreads the number of threads (including the calling thread) to run tasks on.
+   */
+  explicit ThreadPool(const unsigned int nThreads = std::thread::hardware_concurrency());
+
+  /*!
+   * Destructor. Joins all workers.
+   */
+  virtual ~ThreadPool();
+
+  /*!
+   * Get the number of threads that take part in a parallel loop.
+   * @return number of threads (including the calling thread).
+   */
+  unsigned int getNumberOfThreads() const;
+
+  /*!
+   * Runs `function(i)` for all `i` in [0, n) and blocks until all tasks are done.
+   * The order in which the tasks are executed is undefined. If a task throws, the
+   * first exception is rethrown in the calling thread after all tasks have finished.
+   * @param n the number of tasks.
+   * @param function the task to run.
+   */
+  void parallelFor(const size_t n, const std::function<void(size_t)>& function);
+
+  /*!
+   * Get the default thread pool (one thread per hardware core).
+   * @return the default thread pool.
+   */
+  static ThreadPool& getDefault();
+
+ private:
+
+  /*!
+   * Main loop of the worker threads.
+   */
+  void work();
+
+  /*!
+   * Takes tasks of the current parallel loop until none are left.
+   */
+  void runTasks();
+
+  //! Worker threads.
+  std::vector<std::thread> workers_;
+
+  //! Protects the state of the current parallel loop.
+  std::mutex mutex_;
+
+  //! Signals the workers that a new loop is ready or that the pool is stopping.
+  std::condition_variable wakeUp_;
+
+  //! Signals the calling thread that all workers are done.
+  std::condition_variable done_;
+
+  //! Held by the thread that currently runs a parallel loop.
+  std::mutex loopMutex_;
+
+  //! Task of the current parallel loop.
+  const std::function<void(size_t)>* function_;
+
+  //! Number of tasks of the current parallel loop.
+  size_t nTasks_;
+
+  //! Next task to be taken.
+  std::atomic<size_t> nextTask_;
+
+  //! Number of workers that have not finished the current loop yet.
+  size_t nActiveWorkers_;
+
+  //! Counter of the parallel loops, used to wake up the workers.
+  unsigned long generation_;
+
+  //! True if the workers are asked to stop.
+  bool isStopping_;
+
+  //! First exception thrown by a task of the current loop.
+  std::exception_ptr exception_;
+};
+
+} /* namespace */
@@ -0,0 +1,197 @@
+/*
+ * CompactLayer.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/CompactLayer.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace grid_map {
+
+//! Largest magnitude of the ScaledInt16 values (the smallest value is used for invalid cells).
+static const int maxScaledValue = std::numeric_limits<int16_t>::max();
+
+CompactLayer::CompactLayer(const Matrix& data, const StorageType type, const double resolution)
+    : type_(type),
+      data_(data.rows(), data.cols()),
+      scale_(1.0),
+      offset_(0.0)
+{
+  if (type_ == StorageType::Float16) {
+    for (int j = 0; j < data.cols(); ++j) {
+      for (int i = 0; i < data.rows(); ++i) {
+        data_(i, j) = floatToHalf(data(i, j));
+      }
+    }
+    return;
+  }
+
+  // Center the range of the valid values on zero.
+  type_ = StorageType::ScaledInt16;
+  float min = std::numeric_limits<float>::max();
+  float max = -std::numeric_limits<float>::max();
+  for (int j = 0; j < data.cols(); ++j) {
+    for (int i = 0; i < data.rows(); ++i) {
+      const float value = data(i, j);
+      if (!std::isfinite(value)) continue;
+      min = std::min(min, value);
+      max = std::max(max, value);
+    }
+  }
+  if (min <= max) {
+    offset_ = 0.5 * (min + max);
+    if (resolution > 0.0) scale_ = resolution;
+    else if (max > min) scale_ = (max - min) / (2.0 * maxScaledValue);
+  }
+
+  for (int j = 0; j < data.cols(); ++j) {
+    for (int i = 0; i < data.rows(); ++i) {
+      const float value = data(i, j);
+      int16_t scaledValue = invalidValue;
+      if (std::isfinite(value)) {
+        const float scaled = std::round((value - offset_) / scale_);
+        scaledValue = static_cast<int16_t>(std::max(-float(maxScaledValue), std::min(float(maxScaledValue), scaled)));
+      }
+      data_(i, j) = static_cast<uint16_t>(scaledValue);
+    }
+  }
+}
+
+CompactLayer::~CompactLayer()
+{
+}
+
+void CompactLayer::setInvalid(const int row, const int col, const int rows, const int cols)
+{
+  const uint16_t invalid = type_ == StorageType::Float16 ? floatToHalf(NAN) : static_cast<uint16_t>(invalidValue);
+  data_.block(row, col, rows, cols).setConstant(invalid);
+}
+
+void CompactLayer::toMatrix(Matrix& data) const
+{
+  data.resize(data_.rows(), data_.cols());
+  for (int j = 0; j < data_.cols(); ++j) {
+    for (int i = 0; i < data_.rows(); ++i) {
+      data(i, j) = (*this)(i, j);
+    }
+  }
+}
+
+float CompactLayer::minCoeffOfFinites() const
+{
+  float min = std::numeric_limits<float>::max();
+  if (type_ == StorageType::ScaledInt16) {
+    // The order of the scaled values is the order of the values.
+    int minScaledValue = maxScaledValue + 1;
+    for (int j = 0; j < data_.cols(); ++j) {
+      for (int i = 0; i < data_.rows(); ++i) {
+        const int16_t scaledValue = static_cast<int16_t>(data_(i, j));
+        if (scaledValue != invalidValue) minScaledValue = std::min<int>(minScaledValue, scaledValue);
+      }
+    }
+    if (minScaledValue <= maxScaledValue) min = offset_ + scale_ * minScaledValue;
+    return min;
+  }
+  for (int j = 0; j < data_.cols(); ++j) {
+    for (int i = 0; i < data_.rows(); ++i) {
+      const float value = halfToFloat(data_(i, j));
+      if (std::isfinite(value)) min = std::min(min, value);
+    }
+  }
+  return min;
+}
+
+float CompactLayer::maxCoeffOfFinites() const
+{
+  float max = -std::numeric_limits<float>::max();
+  if (type_ == StorageType::ScaledInt16) {
+    int maxValue = -maxScaledValue - 1;
+    for (int j = 0; j < data_.cols(); ++j) {
+      for (int i = 0; i < data_.rows(); ++i) {
+        const int16_t scaledValue = static_cast<int16_t>(data_(i, j));
+        if (scaledValue != invalidValue) maxValue = std::max<int>(maxValue, scaledValue);
+      }
+    }
+    if (maxValue >= -maxScaledValue) max = offset_ + scale_ * maxValue;
+    return max;
+  }
+  for (int j = 0; j < data_.cols(); ++j) {
+    for (int i = 0; i < data_.rows(); ++i) {
+      const float value = halfToFloat(data_(i, j));
+      if (std::isfinite(value)) max = std::max(max, value);
+    }
+  }
+  return max;
+}
+
+StorageType CompactLayer::getType() const
+{
+  return type_;
+}
+
+float CompactLayer::getScale() const
+{
+  return scale_;
+}
+
+float CompactLayer::getOffset() const
+{
+  return offset_;
+}
+
+const CompactLayer::RawMatrix& CompactLayer::getRaw() const
+{
+  return data_;
+}
+
+int CompactLayer::rows() const
+{
+  return data_.rows();
+}
+
+int CompactLayer::cols() const
+{
+  return data_.cols();
+}
+
+uint16_t CompactLayer::floatToHalf(const float value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t absBits = bits & 0x7fffffff;
+
+  // Inf or NaN (keep NaN a NaN).
+  if (absBits >= 0x7f800000) return sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0);
+  // Overflow, rounds to inf.
+  if (absBits >= 0x477ff000) return sign | 0x7c00;
+  // Underflow, rounds to zero.
+  if (absBits < 0x33000000) return sign;
+
+  uint32_t half;
+  uint32_t remainder;
+  uint32_t halfway;
+  if (absBits < 0x38800000) {
+    // Subnormal.
+    const uint32_t exponent = absBits >> 23;
+    const uint32_t mantissa = (absBits & 0x7fffff) | 0x800000;
+    const uint32_t shift = 126 - exponent;
+    half = mantissa >> shift;
+    remainder = mantissa & ((1u << shift) - 1);
+    halfway = 1u << (shift - 1);
+  } else {
+    // Normal, rebias the exponent.
+    half = (absBits - 0x38000000) >> 13;
+    remainder = absBits & 0x1fff;
+    halfway = 0x1000;
+  }
+  // Round to nearest even (a carry into the exponent is correct).
+  if (remainder > halfway || (remainder == halfway && (half & 1))) half++;
+  return sign | half;
+}
+
+} /* namespace */
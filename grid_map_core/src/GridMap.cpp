@@ -10,6 +10,7 @@
 #include "grid_map_core/GridMapMath.hpp"
 #include "grid_map_core/SubmapGeometry.hpp"
 #include "grid_map_core/iterators/GridMapIterator.hpp"
+#include "grid_map_core/ParallelFor.hpp"
 
 #include <iostream>
 #include <cassert>
@@ -31,9 +32,11 @@ GridMap::GridMap(const std::vector<std::string>& layers)
   startIndex_.setZero();
   timestamp_ = 0;
   layers_ = layers;
+  isLazyClearing_ = false;
+  cacheDataBoundingSubmaps_ = false;
 
   for (auto& layer : layers_) {
-    data_.insert(std::pair<std::string, Matrix>(layer, Matrix()));
+    data_.insert(std::make_pair(layer, std::make_shared<Matrix>()));
   }
 }
 
@@ -102,10 +105,13 @@ void GridMap::add(const std::string& layer, const Matrix& data)
 
   if (exists(layer)) {
     // Type exists already, overwrite its data.
-    data_.at(layer) = data;
+    invalidateCaches(layer);
+    removeStaleLayer(layer);
+    compactData_.erase(layer);
+    data_.at(layer) = std::make_shared<Matrix>(data);
   } else {
     // Type does not exist yet, add type and data.
-    data_.insert(std::pair<std::string, Matrix>(layer, data));
+    data_.insert(std::make_pair(layer, std::make_shared<Matrix>(data)));
     layers_.push_back(layer);
   }
 }
@@ -117,17 +123,47 @@ bool GridMap::exists(const std::string& layer) const
 
 const Matrix& GridMap::get(const std::string& layer) const
 {
-  try {
-    return data_.at(layer);
-  } catch (const std::out_of_range& exception) {
+  const auto data = data_.find(layer);
+  if (data == data_.end()) {
     throw std::out_of_range("GridMap::get(...) : No map layer '" + layer + "' available.");
   }
+  if (!data->second || (!staleRegions_.empty() && hasStaleRegions(layer))) return getReadCopy(layer);
+  return *data->second;
+}
+
+const Matrix& GridMap::getDecoded(const std::string& layer, Matrix& decoded) const
+{
+  const std::shared_ptr<Matrix>& data = data_.at(layer);
+  if (data) return *data;
+  compactData_.at(layer)->toMatrix(decoded);
+  return decoded;
+}
+
+const Matrix& GridMap::getReadCopy(const std::string& layer) const
+{
+  std::lock_guard<std::mutex> lock(readCopies_.mutex);
+  auto copy = readCopies_.layers.find(layer);
+  if (copy != readCopies_.layers.end()) return copy->second;
+  copy = readCopies_.layers.emplace(layer, Matrix()).first;
+  Matrix& readCopy = copy->second;
+  const Matrix& data = getDecoded(layer, readCopy);
+  if (&data != &readCopy) readCopy = data;
+  // Cells dropped lazily read as invalid.
+  for (const auto& region : staleRegions_) {
+    if (std::find(region.second.begin(), region.second.end(), layer) == region.second.end()) continue;
+    const Index& startIndex = region.first.getStartIndex();
+    const Size& size = region.first.getSize();
+    readCopy.block(startIndex(0), startIndex(1), size(0), size(1)).setConstant(NAN);
+  }
+  return readCopy;
 }
 
 Matrix& GridMap::get(const std::string& layer)
 {
+  invalidateCaches(layer);
+  if (!staleRegions_.empty()) clearStaleRegions(layer);
   try {
-    return data_.at(layer);
+    return getWritable(layer);
   } catch (const std::out_of_range& exception) {
     throw std::out_of_range("GridMap::get(...) : No map layer of type '" + layer + "' available.");
   }
@@ -148,6 +184,9 @@ bool GridMap::erase(const std::string& layer)
   const auto dataIterator = data_.find(layer);
   if (dataIterator == data_.end()) return false;
   data_.erase(dataIterator);
+  compactData_.erase(layer);
+  invalidateCaches(layer);
+  removeStaleLayer(layer);
 
   const auto layerIterator = std::find(layers_.begin(), layers_.end(), layer);
   if (layerIterator == layers_.end()) return false;
@@ -159,6 +198,63 @@ bool GridMap::erase(const std::string& layer)
   return true;
 }
 
+void GridMap::setStorageType(const std::string& layer, const StorageType type, const double resolution)
+{
+  if (!exists(layer)) {
+    throw std::out_of_range("GridMap::setStorageType(...) : No map layer '" + layer + "' available.");
+  }
+  if (type == StorageType::Float32) {
+    // Convert back to float data.
+    if (compactData_.count(layer) > 0) {
+      invalidateCaches(layer);
+      getWritable(layer);
+    }
+    return;
+  }
+  invalidateCaches(layer);
+  if (!staleRegions_.empty()) clearStaleRegions(layer);
+  Matrix decoded;
+  const Matrix& data = getDecoded(layer, decoded);
+  compactData_[layer] = std::make_shared<CompactLayer>(data, type, resolution);
+  // Release the float data (if not shared with other copies).
+  data_.at(layer).reset();
+}
+
+StorageType GridMap::getStorageType(const std::string& layer) const
+{
+  const auto compact = compactData_.find(layer);
+  if (compact == compactData_.end()) return StorageType::Float32;
+  return compact->second->getType();
+}
+
+const CompactLayer& GridMap::getCompact(const std::string& layer) const
+{
+  const auto compact = compactData_.find(layer);
+  if (compact == compactData_.end()) {
+    throw std::out_of_range("GridMap::getCompact(...) : No compact map layer '" + layer + "' available.");
+  }
+  return *compact->second;
+}
+
+bool GridMap::hasStaleRegions(const std::string& layer) const
+{
+  for (const auto& region : staleRegions_) {
+    if (std::find(region.second.begin(), region.second.end(), layer) != region.second.end()) return true;
+  }
+  return false;
+}
+
+bool GridMap::isShared(const std::string& layer, const GridMap& other) const
+{
+  const auto data = data_.find(layer);
+  const auto otherData = other.data_.find(layer);
+  if (data == data_.end() || otherData == other.data_.end()) return false;
+  if (data->second) return data->second == otherData->second;
+  const auto compact = compactData_.find(layer);
+  const auto otherCompact = other.compactData_.find(layer);
+  return !otherData->second && compact != compactData_.end() && otherCompact != other.compactData_.end() && compact->second == otherCompact->second;
+}
+
 const std::vector<std::string>& GridMap::getLayers() const
 {
   return layers_;
@@ -184,8 +280,25 @@ float GridMap::atPosition(const std::string& layer, const Position& position) co
 
 float& GridMap::at(const std::string& layer, const Index& index)
 {
+  invalidateCaches(layer);
   try {
-    return data_.at(layer)(index(0), index(1));
+    Matrix& data = getWritable(layer);
+    // Clear the dropped regions before the cell is written.
+    for (auto region = staleRegions_.begin(); region != staleRegions_.end();) {
+      const Index& startIndex = region->first.getStartIndex();
+      const Size& size = region->first.getSize();
+      auto& layers = region->second;
+      const auto layerIterator = std::find(layers.begin(), layers.end(), layer);
+      if ((index < startIndex).any() || (index >= startIndex + size).any() || layerIterator == layers.end()) {
+        ++region;
+        continue;
+      }
+      data.block(startIndex(0), startIndex(1), size(0), size(1)).setConstant(NAN);
+      layers.erase(layerIterator);
+      if (layers.empty()) region = staleRegions_.erase(region);
+      else ++region;
+    }
+    return data(index(0), index(1));
   } catch (const std::out_of_range& exception) {
     throw std::out_of_range("GridMap::at(...) : No map layer '" + layer + "' available.");
   }
@@ -194,7 +307,10 @@ float& GridMap::at(const std::string& layer, const Index& index)
 float GridMap::at(const std::string& layer, const Index& index) const
 {
   try {
-    return data_.at(layer)(index(0), index(1));
+    const std::shared_ptr<Matrix>& data = data_.at(layer);
+    const float value = data ? (*data)(index(0), index(1)) : (*compactData_.at(layer))(index(0), index(1));
+    if (!staleRegions_.empty() && isStale(layer, index)) return NAN;
+    return value;
   } catch (const std::out_of_range& exception) {
     throw std::out_of_range("GridMap::at(...) : No map layer '" + layer + "' available.");
   }
@@ -292,24 +408,49 @@ GridMap GridMap::getSubmap(const Position& position, const Length& length,
     return GridMap(layers_);
   }
 
-  for (auto& data : data_) {
+  Matrix decoded;
+  for (const auto& layer : layers_) {
+    const Matrix& data = getDecoded(layer, decoded);
+    Matrix& submapData = *submap.data_[layer];
     for (const auto& bufferRegion : bufferRegions) {
       Index index = bufferRegion.getStartIndex();
       Size size = bufferRegion.getSize();
 
       if (bufferRegion.getQuadrant() == BufferRegion::Quadrant::TopLeft) {
-        submap.data_[data.first].topLeftCorner(size(0), size(1)) = data.second.block(index(0), index(1), size(0), size(1));
+        submapData.topLeftCorner(size(0), size(1)) = data.block(index(0), index(1), size(0), size(1));
       } else if (bufferRegion.getQuadrant() == BufferRegion::Quadrant::TopRight) {
-        submap.data_[data.first].topRightCorner(size(0), size(1)) = data.second.block(index(0), index(1), size(0), size(1));
+        submapData.topRightCorner(size(0), size(1)) = data.block(index(0), index(1), size(0), size(1));
       } else if (bufferRegion.getQuadrant() == BufferRegion::Quadrant::BottomLeft) {
-        submap.data_[data.first].bottomLeftCorner(size(0), size(1)) = data.second.block(index(0), index(1), size(0), size(1));
+        submapData.bottomLeftCorner(size(0), size(1)) = data.block(index(0), index(1), size(0), size(1));
       } else if (bufferRegion.getQuadrant() == BufferRegion::Quadrant::BottomRight) {
-        submap.data_[data.first].bottomRightCorner(size(0), size(1)) = data.second.block(index(0), index(1), size(0), size(1));
+        submapData.bottomRightCorner(size(0), size(1)) = data.block(index(0), index(1), size(0), size(1));
       }
 
     }
   }
 
+  // Cells dropped lazily are invalid in the submap, this map is not modified.
+  for (const auto& staleRegion : staleRegions_) {
+    const Index& staleStartIndex = staleRegion.first.getStartIndex();
+    const Index staleEndIndex = staleStartIndex + staleRegion.first.getSize();
+    for (const auto& bufferRegion : bufferRegions) {
+      const Index& index = bufferRegion.getStartIndex();
+      const Size& size = bufferRegion.getSize();
+      const Index startIndex = index.max(staleStartIndex);
+      const Index endIndex = (index + size).min(staleEndIndex);
+      if ((startIndex >= endIndex).any()) continue;
+      Index submapIndex = startIndex - index;
+      const BufferRegion::Quadrant quadrant = bufferRegion.getQuadrant();
+      if (quadrant == BufferRegion::Quadrant::BottomLeft || quadrant == BufferRegion::Quadrant::BottomRight) submapIndex(0) += submap.size_(0) - size(0);
+      if (quadrant == BufferRegion::Quadrant::TopRight || quadrant == BufferRegion::Quadrant::BottomRight) submapIndex(1) += submap.size_(1) - size(1);
+      const Size staleSize = endIndex - startIndex;
+      for (const auto& layer : staleRegion.second) {
+        if (!submap.exists(layer)) continue;
+        submap.data_.at(layer)->block(submapIndex(0), submapIndex(1), staleSize(0), staleSize(1)).setConstant(NAN);
+      }
+    }
+  }
+
   isSuccess = true;
   return submap;
 }
@@ -326,13 +467,19 @@ bool GridMap::move(const Position& position, std::vector<BufferRegion>& newRegio
   getIndexShiftFromPositionShift(indexShift, positionShift, resolution_);
   Position alignedPositionShift;
   getPositionShiftFromIndexShift(alignedPositionShift, indexShift, resolution_);
+  if (indexShift.any()) invalidateCaches();
 
   // Delete fields that fall out of map (and become empty cells).
   for (int i = 0; i < indexShift.size(); i++) {
     if (indexShift(i) != 0) {
       if (abs(indexShift(i)) >= getSize()(i)) {
         // Entire map is dropped.
-        clearAll();
+        if (isLazyClearing_) {
+          staleRegions_.clear();
+          addStaleRegion(BufferRegion(Index(0, 0), getSize(), BufferRegion::Quadrant::Undefined), layers_);
+        } else {
+          clearAll();
+        }
         newRegions.push_back(BufferRegion(Index(0, 0), getSize(), BufferRegion::Quadrant::Undefined));
       } else {
         // Drop cells out of map.
@@ -393,6 +540,22 @@ bool GridMap::move(const Position& position)
   return move(position, newRegions);
 }
 
+void GridMap::setLazyClearing(const bool enable)
+{
+  isLazyClearing_ = enable;
+  if (!enable) flush();
+}
+
+bool GridMap::isLazyClearing() const
+{
+  return isLazyClearing_;
+}
+
+void GridMap::flush()
+{
+  clearStaleRegions();
+}
+
 bool GridMap::addDataFrom(const GridMap& other, bool extendMap, bool overwriteData,
                           bool copyAllLayers, std::vector<std::string> layers)
 {
@@ -409,18 +572,27 @@ bool GridMap::addDataFrom(const GridMap& other, bool extendMap, bool overwriteDa
     }
   }
   // Copy data.
-  for (GridMapIterator iterator(*this); !iterator.isPastEnd(); ++iterator) {
-    if (isValid(*iterator) && !overwriteData) continue;
+  std::vector<Matrix*> data;
+  std::vector<const Matrix*> otherData;
+  std::vector<Matrix> otherDecoded(layers.size());
+  for (size_t i = 0; i < layers.size(); ++i) {
+    data.push_back(&get(layers[i]));
+    otherData.push_back(&other.getDecoded(layers[i], otherDecoded[i]));
+  }
+  parallelForEachCell(*this, [&](const Index& index) {
+    if (isValid(index) && !overwriteData) return;
     Position position;
-    getPosition(*iterator, position);
-    Index index;
-    if (!other.isInside(position)) continue;
-    other.getIndex(position, index);
-    for (const auto& layer : layers) {
-      if (!other.isValid(index, layer)) continue;
-      at(layer, *iterator) = other.at(layer, index);
+    getPosition(index, position);
+    Index otherIndex;
+    if (!other.isInside(position)) return;
+    other.getIndex(position, otherIndex);
+    for (size_t i = 0; i < data.size(); ++i) {
+      const float value = (*otherData[i])(otherIndex(0), otherIndex(1));
+      if (!isfinite(value)) continue;
+      if (!other.staleRegions_.empty() && other.isStale(layers[i], otherIndex)) continue;
+      (*data[i])(index(0), index(1)) = value;
     }
-  }
+  });
 
   return true;
 }
@@ -481,17 +653,23 @@ bool GridMap::extendToInclude(const GridMap& other)
       position_.y() += -std::copysign(resolution_ / 2.0, shift.y());
     }
     // Copy data.
-    for (GridMapIterator iterator(*this); !iterator.isPastEnd(); ++iterator) {
-      if (isValid(*iterator)) continue;
+    std::vector<Matrix*> data;
+    std::vector<const Matrix*> copyData;
+    for (const auto& layer : layers_) {
+      data.push_back(&get(layer));
+      copyData.push_back(&mapCopy.get(layer));
+    }
+    parallelForEachCell(*this, [&](const Index& index) {
+      if (isValid(index)) return;
       Position position;
-      getPosition(*iterator, position);
-      Index index;
-      if (!mapCopy.isInside(position)) continue;
-      mapCopy.getIndex(position, index);
-      for (const auto& layer : layers_) {
-        at(layer, *iterator) = mapCopy.at(layer, index);
+      getPosition(index, position);
+      Index copyIndex;
+      if (!mapCopy.isInside(position)) return;
+      mapCopy.getIndex(position, copyIndex);
+      for (size_t i = 0; i < data.size(); ++i) {
+        (*data[i])(index(0), index(1)) = (*copyData[i])(copyIndex(0), copyIndex(1));
       }
-    }
+    });
   }
   return true;
 }
@@ -544,59 +722,74 @@ const Size& GridMap::getSize() const
 
 void GridMap::getDataBoundingSubmap(const std::string& layer, Index& startIndex, Size& size)
 {
-  Index minIndex = Index(-1, -1);
-  Index maxIndex = Index(-1, -1);
-  for (int i = 0; i < size_(0); i++)
-  {
-    int it = (startIndex_(0) + i) % size_(0);
-    int ib = (size_(0) + startIndex_(0) - 1 - i) % size_(0);
-    for (int j = 0; j < size_(1); j++)
-    {
-      int jt = (startIndex_(1) + j) % size_(1);
-      int jb = (size_(1) + startIndex_(1) - 1 - j) % size_(1);
-      if (minIndex(0) == -1)
-      {
-        float data = data_.at(layer)(it, jt);
-        if (data == data) { minIndex(0) = it; }
-      }
-      if (maxIndex(0) == -1)
-      {
-        float data = data_.at(layer)(ib, jb);
-        if (data == data) { maxIndex(0) = ib; }
-      }
-      if (minIndex(0) != -1 && maxIndex(0) != -1 ) { break; }
+  if (cacheDataBoundingSubmaps_) {
+    const auto cached = dataBoundingSubmaps_.find(layer);
+    if (cached != dataBoundingSubmaps_.end()) {
+      startIndex = cached->second.getStartIndex();
+      size = cached->second.getSize();
+      return;
     }
-    if (minIndex(0) != -1 && maxIndex(0) != -1 ) { break; }
-  }
-
-  for (int j = 0; j < size_(1); j++)
-  {
-    int jt = (startIndex_(1) + j) % size_(1);
-    int jb = (size_(1) + startIndex_(1) - 1 - j) % size_(1);
-    for (int i = 0; i < size_(0); i++)
-    {
-      int it = (startIndex_(0) + i) % size_(0);
-      int ib = (size_(0) + startIndex_(0) - 1 - i) % size_(0);
-      if (minIndex(1) == -1)
-      {
-        float data = data_.at(layer)(it, jt);
-        if (data == data) { minIndex(1) = jt; }
-      }
-      if (maxIndex(1) == -1)
-      {
-        float data = data_.at(layer)(ib, jb);
-        if (data == data) { maxIndex(1) = jb; }
+  }
+
+  // Flag rows and columns that contain valid cells, column by column in storage order.
+  if (!staleRegions_.empty()) clearStaleRegions(layer);
+  Matrix decoded;
+  const Matrix& data = getDecoded(layer, decoded);
+  Eigen::Array<bool, Eigen::Dynamic, 1> validRows = Eigen::Array<bool, Eigen::Dynamic, 1>::Constant(size_(0), false);
+  Eigen::Array<bool, Eigen::Dynamic, 1> validCols(size_(1));
+  bool allRowsValid = false;
+  for (int j = 0; j < size_(1); ++j) {
+    const auto column = data.col(j).array();
+    if (allRowsValid) {
+      validCols(j) = (column == column).any();
+    } else if (column.allFinite()) {
+      validCols(j) = true;
+      validRows.setConstant(true);
+      allRowsValid = true;
+    } else {
+      const auto validCells = (column == column);
+      validCols(j) = validCells.any();
+      if (validCols(j)) {
+        validRows = validRows || validCells;
+        allRowsValid = validRows.all();
       }
-      if (minIndex(1) != -1 && maxIndex(1) != -1) { break; }
     }
-    if (minIndex(1) != -1 && maxIndex(1) != -1 ) { break; }
   }
-  startIndex = minIndex;
-  size(0) = (size_(0) + maxIndex(0) + 1 - minIndex(0)) % size_(0);
-  size(1) = (size_(1) + maxIndex(1) + 1 - minIndex(1)) % size_(1);
+
+  // Find the first and last valid row and column in the (unwrapped) map order.
+  Index minIndex(-1, -1);
+  Index maxIndex(-1, -1);
+  for (int i = 0; i < size_(0); i++) {
+    if (minIndex(0) == -1 && validRows((startIndex_(0) + i) % size_(0))) minIndex(0) = i;
+    if (maxIndex(0) == -1 && validRows((startIndex_(0) + size_(0) - 1 - i) % size_(0))) maxIndex(0) = size_(0) - 1 - i;
+  }
+  for (int j = 0; j < size_(1); j++) {
+    if (minIndex(1) == -1 && validCols((startIndex_(1) + j) % size_(1))) minIndex(1) = j;
+    if (maxIndex(1) == -1 && validCols((startIndex_(1) + size_(1) - 1 - j) % size_(1))) maxIndex(1) = size_(1) - 1 - j;
+  }
+
+  if ((minIndex == -1).any()) {
+    startIndex = Index(-1, -1);
+    size.setZero();
+  } else {
+    startIndex = startIndex_ + minIndex;
+    mapIndexWithinRange(startIndex, size_);
+    size = maxIndex - minIndex + Size::Ones();
+  }
+
+  if (cacheDataBoundingSubmaps_) {
+    dataBoundingSubmaps_[layer] = BufferRegion(startIndex, size, BufferRegion::Quadrant::Undefined);
+  }
+}
+
+void GridMap::setDataBoundingSubmapCaching(const bool enable)
+{
+  cacheDataBoundingSubmaps_ = enable;
+  if (!enable) dataBoundingSubmaps_.clear();
 }
 
 void GridMap::setStartIndex(const Index& startIndex) {
+  invalidateCaches();
   startIndex_ = startIndex;
 }
 
@@ -607,8 +800,14 @@ const Index& GridMap::getStartIndex() const
 
 void GridMap::clear(const std::string& layer)
 {
+  invalidateCaches(layer);
+  removeStaleLayer(layer);
   try {
-    data_.at(layer).setConstant(NAN);
+    // Replace shared data instead of copying it first.
+    std::shared_ptr<Matrix>& data = data_.at(layer);
+    if (compactData_.count(layer) > 0) clearBlock(layer, Index(0, 0), size_);
+    else if (!data || data.use_count() > 1) data = std::make_shared<Matrix>(Matrix::Constant(size_(0), size_(1), NAN));
+    else data->setConstant(NAN);
   } catch (const std::out_of_range& exception) {
     throw std::out_of_range("GridMap::clear(...) : No map layer '" + layer + "' available.");
   }
@@ -623,8 +822,12 @@ void GridMap::clearBasic()
 
 void GridMap::clearAll()
 {
+  invalidateCaches();
+  staleRegions_.clear();
   for (auto& data : data_) {
-    data.second.setConstant(NAN);
+    if (compactData_.count(data.first) > 0) clearBlock(data.first, Index(0, 0), size_);
+    else if (!data.second || data.second.use_count() > 1) data.second = std::make_shared<Matrix>(Matrix::Constant(size_(0), size_(1), NAN));
+    else data.second->setConstant(NAN);
   }
 }
 
@@ -633,8 +836,12 @@ void GridMap::clearRows(unsigned int index, unsigned int nRows)
   std::vector<std::string> layersToClear;
   if (basicLayers_.size() > 0) layersToClear = basicLayers_;
   else layersToClear = layers_;
+  if (isLazyClearing_) {
+    addStaleRegion(BufferRegion(Index(index, 0), Size(nRows, getSize()(1)), BufferRegion::Quadrant::Undefined), layersToClear);
+    return;
+  }
   for (auto& layer : layersToClear) {
-    data_.at(layer).block(index, 0, nRows, getSize()(1)).setConstant(NAN);
+    clearBlock(layer, Index(index, 0), Size(nRows, getSize()(1)));
   }
 }
 
@@ -643,17 +850,126 @@ void GridMap::clearCols(unsigned int index, unsigned int nCols)
   std::vector<std::string> layersToClear;
   if (basicLayers_.size() > 0) layersToClear = basicLayers_;
   else layersToClear = layers_;
+  if (isLazyClearing_) {
+    addStaleRegion(BufferRegion(Index(0, index), Size(getSize()(0), nCols), BufferRegion::Quadrant::Undefined), layersToClear);
+    return;
+  }
   for (auto& layer : layersToClear) {
-    data_.at(layer).block(0, index, getSize()(0), nCols).setConstant(NAN);
+    clearBlock(layer, Index(0, index), Size(getSize()(0), nCols));
+  }
+}
+
+void GridMap::clearBlock(const std::string& layer, const Index& index, const Size& size)
+{
+  invalidateCaches(layer);
+  const auto compact = compactData_.find(layer);
+  if (compact == compactData_.end()) {
+    getWritable(layer).block(index(0), index(1), size(0), size(1)).setConstant(NAN);
+    return;
+  }
+  if (compact->second.use_count() > 1) compact->second = std::make_shared<CompactLayer>(*compact->second);
+  compact->second->setInvalid(index(0), index(1), size(0), size(1));
+}
+
+void GridMap::addStaleRegion(const BufferRegion& region, const std::vector<std::string>& layers)
+{
+  // Bound the bookkeeping if the map is moved many times without being written.
+  const size_t maxNumberOfStaleRegions = 16;
+  if (staleRegions_.size() >= maxNumberOfStaleRegions) clearStaleRegions();
+  staleRegions_.push_back(std::make_pair(region, layers));
+}
+
+bool GridMap::isStale(const std::string& layer, const Index& index) const
+{
+  for (const auto& region : staleRegions_) {
+    const Index& startIndex = region.first.getStartIndex();
+    if ((index < startIndex).any() || (index >= startIndex + region.first.getSize()).any()) continue;
+    if (std::find(region.second.begin(), region.second.end(), layer) != region.second.end()) return true;
   }
+  return false;
+}
+
+void GridMap::clearStaleRegions(const std::string& layer)
+{
+  for (auto region = staleRegions_.begin(); region != staleRegions_.end();) {
+    auto& layers = region->second;
+    const auto layerIterator = std::find(layers.begin(), layers.end(), layer);
+    if (layerIterator != layers.end()) {
+      const Index& startIndex = region->first.getStartIndex();
+      const Size& size = region->first.getSize();
+      if (exists(layer)) clearBlock(layer, startIndex, size);
+      layers.erase(layerIterator);
+    }
+    if (layers.empty()) region = staleRegions_.erase(region);
+    else ++region;
+  }
+}
+
+void GridMap::clearStaleRegions()
+{
+  for (const auto& region : staleRegions_) {
+    const Index& startIndex = region.first.getStartIndex();
+    const Size& size = region.first.getSize();
+    for (const auto& layer : region.second) {
+      if (!exists(layer)) continue;
+      clearBlock(layer, startIndex, size);
+    }
+  }
+  staleRegions_.clear();
+}
+
+void GridMap::removeStaleLayer(const std::string& layer)
+{
+  for (auto region = staleRegions_.begin(); region != staleRegions_.end();) {
+    auto& layers = region->second;
+    layers.erase(std::remove(layers.begin(), layers.end(), layer), layers.end());
+    if (layers.empty()) region = staleRegions_.erase(region);
+    else ++region;
+  }
+}
+
+void GridMap::invalidateCaches(const std::string& layer)
+{
+  if (!dataBoundingSubmaps_.empty()) dataBoundingSubmaps_.erase(layer);
+  if (!readCopies_.layers.empty()) readCopies_.layers.erase(layer);
+}
+
+void GridMap::invalidateCaches()
+{
+  dataBoundingSubmaps_.clear();
+  readCopies_.layers.clear();
 }
 
 void GridMap::resize(const Index& size)
 {
+  invalidateCaches();
+  staleRegions_.clear();
+  compactData_.clear();
   size_ = size;
   for (auto& data : data_) {
-    data.second.resize(size_(0), size_(1));
+    if (!data.second || data.second.use_count() > 1) data.second = std::make_shared<Matrix>(size_(0), size_(1));
+    else data.second->resize(size_(0), size_(1));
+  }
+}
+
+Matrix& GridMap::getUnshared(std::shared_ptr<Matrix>& data)
+{
+  if (data.use_count() > 1) data = std::make_shared<Matrix>(*data);
+  return *data;
+}
+
+Matrix& GridMap::getWritable(const std::string& layer)
+{
+  std::shared_ptr<Matrix>& data = data_.at(layer);
+  const auto compact = compactData_.find(layer);
+  if (compact != compactData_.end()) {
+    if (!data) {
+      data = std::make_shared<Matrix>();
+      compact->second->toMatrix(*data);
+    }
+    compactData_.erase(compact);
   }
+  return getUnshared(data);
 }
 
 } /* namespace */
@@ -14,6 +14,9 @@
 // Limits
 #include <limits>
 
+// min, max
+#include <algorithm>
+
 using namespace Eigen;
 using namespace std;
 
@@ -411,6 +414,65 @@ bool getBufferRegionsForSubmap(std::vector<BufferRegion>& submapBufferRegions,
   return false;
 }
 
+bool getBufferSpansForSubmap(std::vector<BufferRegion>& spans,
+                             const Index& submapIndex,
+                             const Size& submapBufferSize,
+                             const Size& bufferSize,
+                             const Index& bufferStartIndex,
+                             const unsigned int nBlocks)
+{
+  std::vector<BufferRegion> bufferRegions;
+  if (!getBufferRegionsForSubmap(bufferRegions, submapIndex, submapBufferSize, bufferSize, bufferStartIndex)) return false;
+
+  spans.clear();
+  const double nCells = submapBufferSize.prod();
+  for (const auto& bufferRegion : bufferRegions) {
+    const Index& index = bufferRegion.getStartIndex();
+    const Size& size = bufferRegion.getSize();
+    if ((size <= 0).any()) continue;
+
+    // Distribute the blocks according to the number of cells of the region.
+    int nRegionBlocks = ceil(nBlocks * size.prod() / nCells);
+    nRegionBlocks = std::max(1, std::min(nRegionBlocks, size(0)));
+
+    int startRow = 0;
+    for (int k = 0; k < nRegionBlocks; ++k) {
+      const int endRow = (size(0) * (k + 1)) / nRegionBlocks;
+      spans.push_back(BufferRegion(Index(index(0) + startRow, index(1)), Size(endRow - startRow, size(1)),
+                                   bufferRegion.getQuadrant()));
+      startRow = endRow;
+    }
+  }
+  return true;
+}
+
+void getRowBlocksForSubmap(std::vector<BufferRegion>& blocks,
+                           const Index& submapIndex,
+                           const Size& submapBufferSize,
+                           const Size& bufferSize,
+                           const Index& bufferStartIndex,
+                           const unsigned int nBlocks,
+                           const int every)
+{
+  blocks.clear();
+  if ((submapBufferSize <= 0).any() || nBlocks == 0 || every <= 0) return;
+
+  // Split on the rows visited by a sparse iteration.
+  const int nSparseRows = (submapBufferSize(0) + every - 1) / every;
+  const int nRowBlocks = std::min(static_cast<int>(nBlocks), nSparseRows);
+  const Index unwrappedSubmapIndex = getIndexFromBufferIndex(submapIndex, bufferSize, bufferStartIndex);
+
+  int startSparseRow = 0;
+  for (int k = 0; k < nRowBlocks; ++k) {
+    const int endSparseRow = (nSparseRows * (k + 1)) / nRowBlocks;
+    const int startRow = startSparseRow * every;
+    const int endRow = std::min(endSparseRow * every, submapBufferSize(0));
+    const Index index = getBufferIndexFromIndex(unwrappedSubmapIndex + Index(startRow, 0), bufferSize, bufferStartIndex);
+    blocks.push_back(BufferRegion(index, Size(endRow - startRow, submapBufferSize(1)), BufferRegion::Quadrant::Undefined));
+    startSparseRow = endSparseRow;
+  }
+}
+
 bool incrementIndex(Index& index, const Size& bufferSize, const Index& bufferStartIndex)
 {
   Index unwrappedIndex = getIndexFromBufferIndex(index, bufferSize, bufferStartIndex);
@@ -0,0 +1,38 @@
+/*
+ * LayerView.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/LayerView.hpp"
+
+namespace grid_map {
+
+LayerView::LayerView(const GridMap& gridMap, const std::string& layer)
+    : data_(nullptr),
+      compact_(nullptr)
+{
+  if (gridMap.getStorageType(layer) == StorageType::Float32 || gridMap.hasStaleRegions(layer)) data_ = &gridMap.get(layer);
+  else compact_ = &gridMap.getCompact(layer);
+}
+
+float LayerView::minCoeffOfFinites() const
+{
+  if (compact_ == nullptr) return data_->minCoeffOfFinites();
+  return compact_->minCoeffOfFinites();
+}
+
+float LayerView::maxCoeffOfFinites() const
+{
+  if (compact_ == nullptr) return data_->maxCoeffOfFinites();
+  return compact_->maxCoeffOfFinites();
+}
+
+StorageType LayerView::getStorageType() const
+{
+  if (compact_ == nullptr) return StorageType::Float32;
+  return compact_->getType();
+}
+
+} /* namespace */
@@ -0,0 +1,59 @@
+/*
+ * ParallelFor.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/ParallelFor.hpp"
+#include "grid_map_core/GridMapMath.hpp"
+
+#include <vector>
+
+namespace grid_map {
+
+//! Number of spans per thread, more spans balance the load better.
+static const unsigned int spansPerThread = 4;
+
+bool parallelForEachSpan(const GridMap& gridMap, const Index& submapStartIndex, const Size& submapSize,
+                         const std::function<void(const BufferRegion&)>& function,
+                         ThreadPool& threadPool)
+{
+  std::vector<BufferRegion> spans;
+  if (!getBufferSpansForSubmap(spans, submapStartIndex, submapSize, gridMap.getSize(),
+                               gridMap.getStartIndex(), spansPerThread * threadPool.getNumberOfThreads())) {
+    return false;
+  }
+  threadPool.parallelFor(spans.size(), [&spans, &function](size_t i) { function(spans[i]); });
+  return true;
+}
+
+void parallelForEachSpan(const GridMap& gridMap, const std::function<void(const BufferRegion&)>& function,
+                         ThreadPool& threadPool)
+{
+  parallelForEachSpan(gridMap, gridMap.getStartIndex(), gridMap.getSize(), function, threadPool);
+}
+
+bool parallelForEachCell(const GridMap& gridMap, const Index& submapStartIndex, const Size& submapSize,
+                         const std::function<void(const Index&)>& function,
+                         ThreadPool& threadPool)
+{
+  return parallelForEachSpan(gridMap, submapStartIndex, submapSize, [&function](const BufferRegion& span) {
+    const Index& startIndex = span.getStartIndex();
+    const Size& size = span.getSize();
+    // Column-major, like the data storage.
+    for (int j = startIndex(1); j < startIndex(1) + size(1); ++j) {
+      for (int i = startIndex(0); i < startIndex(0) + size(0); ++i) {
+        function(Index(i, j));
+      }
+    }
+  }, threadPool);
+}
+
+void parallelForEachCell(const GridMap& gridMap, const std::function<void(const Index&)>& function,
+                         ThreadPool& threadPool)
+{
+  parallelForEachCell(gridMap, gridMap.getStartIndex(), gridMap.getSize(), function, threadPool);
+}
+
+} /* namespace */
@@ -0,0 +1,123 @@
+/*
+ * ThreadPool.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/ThreadPool.hpp"
+
+namespace grid_map {
+
+namespace {
+
+//! True while the current thread runs tasks of a parallel loop.
+thread_local bool isInsideParallelFor = false;
+
+}
+
+ThreadPool::ThreadPool(const unsigned int nThreads)
+    : function_(nullptr),
+      nTasks_(0),
+      nextTask_(0),
+      nActiveWorkers_(0),
+      generation_(0),
+      isStopping_(false)
+{
+  for (unsigned int i = 1; i < nThreads; ++i) {
+    workers_.push_back(std::thread(&ThreadPool::work, this));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopping_ = true;
+  }
+  wakeUp_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+unsigned int ThreadPool::getNumberOfThreads() const
+{
+  return workers_.size() + 1;
+}
+
+void ThreadPool::parallelFor(const size_t n, const std::function<void(size_t)>& function)
+{
+  if (n == 0) return;
+
+  // Run serially if there is nothing to share or the pool is busy.
+  if (workers_.empty() || n == 1 || isInsideParallelFor || !loopMutex_.try_lock()) {
+    for (size_t i = 0; i < n; ++i) {
+      function(i);
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> loopLock(loopMutex_, std::adopt_lock);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    function_ = &function;
+    nTasks_ = n;
+    nextTask_ = 0;
+    nActiveWorkers_ = workers_.size();
+    exception_ = nullptr;
+    ++generation_;
+  }
+  wakeUp_.notify_all();
+
+  runTasks();
+
+  std::exception_ptr exception;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return nActiveWorkers_ == 0; });
+    function_ = nullptr;
+    exception = exception_;
+    exception_ = nullptr;
+  }
+  if (exception) std::rethrow_exception(exception);
+}
+
+ThreadPool& ThreadPool::getDefault()
+{
+  static ThreadPool threadPool;
+  return threadPool;
+}
+
+void ThreadPool::work()
+{
+  unsigned long generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wakeUp_.wait(lock, [this, &generation] { return isStopping_ || generation_ != generation; });
+    if (isStopping_) return;
+    generation = generation_;
+
+    lock.unlock();
+    runTasks();
+    lock.lock();
+
+    if (--nActiveWorkers_ == 0) done_.notify_one();
+  }
+}
+
+void ThreadPool::runTasks()
+{
+  isInsideParallelFor = true;
+  for (size_t i = nextTask_++; i < nTasks_; i = nextTask_++) {
+    try {
+      (*function_)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!exception_) exception_ = std::current_exception();
+    }
+  }
+  isInsideParallelFor = false;
+}
+
+} /* namespace */
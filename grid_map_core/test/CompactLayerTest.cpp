@@ -0,0 +1,150 @@
+/*
+ * CompactLayerTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/GridMap.hpp"
+#include "grid_map_core/iterators/GridMapIterator.hpp"
+#include "grid_map_core/CompactLayer.hpp"
+#include "grid_map_core/LayerView.hpp"
+
+// gtest
+#include <gtest/gtest.h>
+
+// Math
+#include <math.h>
+#include <vector>
+
+using namespace std;
+using namespace grid_map;
+
+TEST(CompactLayer, HalfRoundTrip)
+{
+  for (uint32_t half = 0; half < 65536; ++half) {
+    const float value = CompactLayer::halfToFloat(half);
+    if (std::isnan(value)) {
+      EXPECT_TRUE(std::isnan(CompactLayer::halfToFloat(CompactLayer::floatToHalf(value))));
+    } else {
+      EXPECT_EQ(half, CompactLayer::floatToHalf(value));
+    }
+  }
+}
+
+TEST(CompactLayer, ScaledInt16)
+{
+  Matrix data(20, 30);
+  data.setRandom();
+  data *= 5.0;
+  data(3, 4) = NAN;
+  const double resolution = 0.001;
+
+  const CompactLayer compact(data, StorageType::ScaledInt16, resolution);
+  EXPECT_EQ(StorageType::ScaledInt16, compact.getType());
+  for (int j = 0; j < data.cols(); ++j) {
+    for (int i = 0; i < data.rows(); ++i) {
+      if (std::isnan(data(i, j))) {
+        EXPECT_TRUE(std::isnan(compact(i, j)));
+      } else {
+        EXPECT_NEAR(data(i, j), compact(i, j), resolution / 2.0 + 1e-6);
+      }
+    }
+  }
+
+  Matrix decoded;
+  compact.toMatrix(decoded);
+  EXPECT_EQ(data.rows(), decoded.rows());
+  EXPECT_EQ(data.cols(), decoded.cols());
+  EXPECT_EQ(compact(5, 6), decoded(5, 6));
+  EXPECT_NEAR(data.minCoeffOfFinites(), compact.minCoeffOfFinites(), resolution);
+  EXPECT_NEAR(data.maxCoeffOfFinites(), compact.maxCoeffOfFinites(), resolution);
+}
+
+TEST(CompactLayer, GridMapStorage)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(2.0, 1.0), 0.1);
+  map["layer"].setRandom();
+  map.at("layer", Index(1, 2)) = NAN;
+  const GridMap original = map;
+
+  map.setStorageType("layer", StorageType::Float16);
+  EXPECT_EQ(StorageType::Float16, map.getStorageType("layer"));
+  const GridMap& constMap = map;
+  const LayerView view(map, "layer");
+  for (GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    const Index index(*iterator);
+    const float value = original.at("layer", index);
+    if (std::isnan(value)) {
+      EXPECT_TRUE(std::isnan(constMap.at("layer", index)));
+      EXPECT_TRUE(std::isnan(view(index(0), index(1))));
+    } else {
+      EXPECT_NEAR(value, constMap.at("layer", index), 1e-3);
+      EXPECT_EQ(constMap.at("layer", index), view(index(0), index(1)));
+    }
+  }
+
+  // Compact layers are only read through views, submaps are float.
+  const Matrix& decodedLayer = constMap.get("layer");
+  EXPECT_EQ(constMap.at("layer", Index(3, 3)), decodedLayer(3, 3));
+  EXPECT_TRUE(std::isnan(decodedLayer(1, 2)));
+  EXPECT_EQ(&decodedLayer, &constMap["layer"]);
+  EXPECT_EQ(StorageType::Float16, map.getStorageType("layer"));
+  bool isSuccess;
+  const GridMap submap = constMap.getSubmap(map.getPosition(), Length(1.0, 0.5), isSuccess);
+  ASSERT_TRUE(isSuccess);
+  EXPECT_EQ(StorageType::Float32, submap.getStorageType("layer"));
+  EXPECT_EQ(StorageType::Float16, map.getStorageType("layer"));
+
+  // Writing converts the layer back to float, copies stay compact.
+  GridMap copy = map;
+  map.at("layer", Index(0, 0)) = 42.0;
+  EXPECT_EQ(StorageType::Float32, map.getStorageType("layer"));
+  EXPECT_EQ(42.0, map.get("layer")(0, 0));
+  EXPECT_EQ(StorageType::Float16, copy.getStorageType("layer"));
+  EXPECT_NE(42.0, copy.at("layer", Index(0, 0)));
+
+  copy.setStorageType("layer", StorageType::Float32);
+  EXPECT_EQ(StorageType::Float32, copy.getStorageType("layer"));
+  EXPECT_NEAR(original.at("layer", Index(3, 3)), copy.get("layer")(3, 3), 1e-3);
+}
+
+TEST(CompactLayer, ClearingKeepsStorageType)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(2.0, 1.0), 0.1);
+  map["layer"].setConstant(1.0);
+  map.setStorageType("layer", StorageType::ScaledInt16, 0.01);
+  const GridMap copy = map;
+  const GridMap& constMap = map;
+
+  std::vector<BufferRegion> newRegions;
+  map.move(Position(0.3, -0.2), newRegions);
+  EXPECT_EQ(StorageType::ScaledInt16, map.getStorageType("layer"));
+  ASSERT_FALSE(newRegions.empty());
+  const Index index = newRegions[0].getStartIndex();
+  EXPECT_TRUE(std::isnan(map.at("layer", index)));
+  EXPECT_TRUE(std::isnan(constMap.get("layer")(index(0), index(1))));
+  EXPECT_NEAR(1.0, copy.at("layer", index), 0.01);
+  EXPECT_EQ(StorageType::ScaledInt16, copy.getStorageType("layer"));
+
+  // Lazily dropped cells are cleared in the compact form too.
+  map.setStorageType("layer", StorageType::Float16);
+  map.setLazyClearing(true);
+  newRegions.clear();
+  map.move(Position(0.6, -0.2), newRegions);
+  ASSERT_FALSE(newRegions.empty());
+  const Index lazyIndex = newRegions[0].getStartIndex();
+  map.flush();
+  EXPECT_EQ(StorageType::Float16, map.getStorageType("layer"));
+  EXPECT_TRUE(std::isnan(map.getCompact("layer")(lazyIndex(0), lazyIndex(1))));
+
+  map.clear("layer");
+  EXPECT_EQ(StorageType::Float16, map.getStorageType("layer"));
+  EXPECT_TRUE(std::isnan(map.at("layer", Index(0, 0))));
+  map.setStorageType("layer", StorageType::ScaledInt16);
+  map.clearAll();
+  EXPECT_EQ(StorageType::ScaledInt16, map.getStorageType("layer"));
+  EXPECT_TRUE(std::isnan(map.getCompact("layer")(5, 5)));
+}
@@ -0,0 +1,182 @@
+/*
+ * DataBoundingSubmapTest.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/GridMap.hpp"
+
+// gtest
+#include <gtest/gtest.h>
+
+// Math
+#include <math.h>
+
+using namespace std;
+using namespace grid_map;
+
+namespace {
+
+// Cell by cell reference for the bounding submap of the valid (non-NAN) cells.
+void bruteForceDataBoundingSubmap(const GridMap& map, const string& layer, Index& startIndex, Size& size)
+{
+  const Size& mapSize = map.getSize();
+  const Matrix& data = map.get(layer);
+  Index minIndex(mapSize(0), mapSize(1));
+  Index maxIndex(-1, -1);
+  for (int i = 0; i < mapSize(0); ++i) {
+    for (int j = 0; j < mapSize(1); ++j) {
+      if (std::isnan(data(i, j))) continue;
+      const Index unwrapped((i - map.getStartIndex()(0) + mapSize(0)) % mapSize(0),
+                            (j - map.getStartIndex()(1) + mapSize(1)) % mapSize(1));
+      minIndex = minIndex.min(unwrapped);
+      maxIndex = maxIndex.max(unwrapped);
+    }
+  }
+  if ((maxIndex == -1).any()) {
+    startIndex = Index(-1, -1);
+    size.setZero();
+    return;
+  }
+  startIndex = (map.getStartIndex() + minIndex).binaryExpr(mapSize, [](int index, int length) { return index % length; });
+  size = maxIndex - minIndex + Size::Ones();
+}
+
+void expectBoundingSubmap(GridMap& map, const string& layer)
+{
+  Index startIndex, expectedStartIndex;
+  Size size, expectedSize;
+  map.getDataBoundingSubmap(layer, startIndex, size);
+  bruteForceDataBoundingSubmap(map, layer, expectedStartIndex, expectedSize);
+  EXPECT_EQ(expectedStartIndex(0), startIndex(0));
+  EXPECT_EQ(expectedStartIndex(1), startIndex(1));
+  EXPECT_EQ(expectedSize(0), size(0));
+  EXPECT_EQ(expectedSize(1), size(1));
+}
+
+}  // namespace
+
+TEST(DataBoundingSubmap, WrappedBuffer)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(2.0, 1.5), 0.1);
+  const Size& size = map.getSize();
+
+  for (int k = 0; k < 40; ++k) {
+    map.clear("layer");
+    map.setStartIndex(Index((k * 7) % size(0), (k * 3) % size(1)));
+    for (int n = 0; n <= k % 4; ++n) {
+      map.at("layer", Index((k * 5 + n * 11) % size(0), (k * 13 + n * 2) % size(1))) = n;
+    }
+    expectBoundingSubmap(map, "layer");
+  }
+
+  // Valid cells on both sides of the buffer seam.
+  map.clear("layer");
+  map.setStartIndex(Index(5, 4));
+  map.at("layer", Index(3, 2)) = 1.0;
+  map.at("layer", Index(7, 6)) = 1.0;
+  Index startIndex;
+  Size submapSize;
+  map.getDataBoundingSubmap("layer", startIndex, submapSize);
+  EXPECT_EQ(7, startIndex(0));
+  EXPECT_EQ(6, startIndex(1));
+  EXPECT_EQ(size(0) - 3, submapSize(0));
+  EXPECT_EQ(size(1) - 3, submapSize(1));
+  expectBoundingSubmap(map, "layer");
+}
+
+TEST(DataBoundingSubmap, NoValidCells)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(2.0, 1.5), 0.1);
+  map.setStartIndex(Index(3, 4));
+
+  Index startIndex;
+  Size size;
+  map.getDataBoundingSubmap("layer", startIndex, size);
+  EXPECT_EQ(-1, startIndex(0));
+  EXPECT_EQ(-1, startIndex(1));
+  EXPECT_EQ(0, size(0));
+  EXPECT_EQ(0, size(1));
+}
+
+TEST(DataBoundingSubmap, AllValidCells)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(2.0, 1.5), 0.1);
+  map["layer"].setRandom();
+
+  for (const Index& start : {Index(0, 0), Index(3, 4)}) {
+    map.setStartIndex(start);
+    Index startIndex;
+    Size size;
+    map.getDataBoundingSubmap("layer", startIndex, size);
+    EXPECT_EQ(start(0), startIndex(0));
+    EXPECT_EQ(start(1), startIndex(1));
+    EXPECT_EQ(map.getSize()(0), size(0));
+    EXPECT_EQ(map.getSize()(1), size(1));
+  }
+}
+
+TEST(DataBoundingSubmap, InfinityIsValid)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(2.0, 1.5), 0.1);
+  map.at("layer", Index(2, 3)) = INFINITY;
+  map.at("layer", Index(6, 9)) = -INFINITY;
+
+  Index startIndex;
+  Size size;
+  map.getDataBoundingSubmap("layer", startIndex, size);
+  EXPECT_EQ(2, startIndex(0));
+  EXPECT_EQ(3, startIndex(1));
+  EXPECT_EQ(5, size(0));
+  EXPECT_EQ(7, size(1));
+
+  // Infinite values are valid even where a column is not all finite.
+  map["layer"].col(12).setConstant(INFINITY);
+  map.at("layer", Index(0, 12)) = NAN;
+  expectBoundingSubmap(map, "layer");
+}
+
+TEST(DataBoundingSubmap, CacheIsDropped)
+{
+  GridMap map({"layer", "other"});
+  map.setGeometry(Length(2.0, 1.5), 0.1);
+  map.setBasicLayers({"layer"});
+  map.setDataBoundingSubmapCaching(true);
+  map.at("layer", Index(4, 5)) = 1.0;
+  map.at("other", Index(1, 1)) = 1.0;
+  expectBoundingSubmap(map, "layer");
+  expectBoundingSubmap(map, "other");
+
+  map.at("layer", Index(9, 10)) = 1.0;
+  expectBoundingSubmap(map, "layer");
+
+  map.get("layer")(2, 2) = 1.0;
+  expectBoundingSubmap(map, "layer");
+
+  map.move(Position(0.3, -0.2));
+  expectBoundingSubmap(map, "layer");
+
+  map.setStartIndex(Index(1, 2));
+  expectBoundingSubmap(map, "layer");
+
+  map.clear("layer");
+  expectBoundingSubmap(map, "layer");
+  expectBoundingSubmap(map, "other");
+
+  map.at("layer", Index(3, 3)) = 1.0;
+  expectBoundingSubmap(map, "layer");
+  map.clearBasic();
+  expectBoundingSubmap(map, "layer");
+  expectBoundingSubmap(map, "other");
+
+  map.at("layer", Index(3, 3)) = 1.0;
+  expectBoundingSubmap(map, "layer");
+  map.clearAll();
+  expectBoundingSubmap(map, "layer");
+  expectBoundingSubmap(map, "other");
+}
@@ -0,0 +1,66 @@
+/*
+ * GridMapCopyOnWriteTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/GridMap.hpp"
+#include "grid_map_core/iterators/GridMapIterator.hpp"
+
+// gtest
+#include <gtest/gtest.h>
+
+// Math
+#include <math.h>
+
+using namespace std;
+using namespace grid_map;
+
+TEST(GridMap, CopyOnWrite)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(1.0, 2.0), 0.1);
+  map["layer"].setConstant(1.0);
+
+  GridMap copy = map;
+  EXPECT_TRUE(copy.isShared("layer", map));
+
+  // Const access does not copy the data.
+  const GridMap& constCopy = copy;
+  EXPECT_EQ(1.0, constCopy.get("layer")(0, 0));
+  EXPECT_EQ(1.0, constCopy.at("layer", Index(1, 1)));
+  EXPECT_TRUE(copy.isShared("layer", map));
+
+  // Writing to the copy leaves the original unchanged.
+  copy["layer"](0, 0) = 2.0;
+  copy.at("layer", Index(1, 1)) = 3.0;
+  EXPECT_FALSE(copy.isShared("layer", map));
+  EXPECT_EQ(2.0, copy.at("layer", Index(0, 0)));
+  EXPECT_EQ(3.0, copy.at("layer", Index(1, 1)));
+  EXPECT_EQ(1.0, map.at("layer", Index(0, 0)));
+  EXPECT_EQ(1.0, map.at("layer", Index(1, 1)));
+
+  // Writing to the original leaves the copy unchanged.
+  GridMap secondCopy = map;
+  map["layer"](2, 2) = 4.0;
+  EXPECT_EQ(1.0, secondCopy.at("layer", Index(2, 2)));
+  EXPECT_EQ(4.0, map.at("layer", Index(2, 2)));
+}
+
+TEST(GridMap, CopyOnWriteClear)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(1.0, 1.0), 0.1);
+  map["layer"].setConstant(1.0);
+
+  GridMap copy = map;
+  copy.clearAll();
+  EXPECT_TRUE(std::isnan(copy.at("layer", Index(0, 0))));
+  EXPECT_EQ(1.0, map.at("layer", Index(0, 0)));
+
+  copy = map;
+  copy.move(Position(0.3, 0.0));
+  EXPECT_EQ(1.0, map.at("layer", Index(0, 0)));
+  EXPECT_EQ(1.0, map.at("layer", Index(9, 9)));
+}
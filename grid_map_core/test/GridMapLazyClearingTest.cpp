@@ -0,0 +1,115 @@
+/*
+ * GridMapLazyClearingTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/GridMap.hpp"
+#include "grid_map_core/iterators/GridMapIterator.hpp"
+#include "grid_map_core/LayerView.hpp"
+
+// gtest
+#include <gtest/gtest.h>
+
+// Math
+#include <math.h>
+
+using namespace std;
+using namespace grid_map;
+
+TEST(GridMap, LazyClearing)
+{
+  GridMap map({"layer", "other"});
+  map.setGeometry(Length(2.0, 1.5), 0.1);
+  map["layer"].setRandom();
+  map["other"].setRandom();
+
+  GridMap lazyMap = map;
+  lazyMap.setLazyClearing(true);
+  const GridMap& constLazyMap = lazyMap;
+
+  for (int k = 0; k < 20; ++k) {
+    const Position position(((k * 7) % 9 - 4) * 0.05, ((k * 5) % 7 - 3) * 0.1);
+    map.move(position);
+    lazyMap.move(position);
+    if (k % 3 == 0) {
+      const Index index(k % map.getSize()(0), (2 * k) % map.getSize()(1));
+      map.at("layer", index) = k;
+      lazyMap.at("layer", index) = k;
+    }
+
+    // Dropped cells read as invalid.
+    for (GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+      const float value = map.at("layer", *iterator);
+      const float lazyValue = constLazyMap.at("layer", *iterator);
+      EXPECT_TRUE((std::isnan(value) && std::isnan(lazyValue)) || value == lazyValue);
+      EXPECT_EQ(map.isValid(*iterator, "other"), constLazyMap.isValid(*iterator, "other"));
+    }
+
+    // Submaps do not contain the dropped cells.
+    bool isSuccess, isLazySuccess;
+    const GridMap submap = map.getSubmap(map.getPosition(), Length(0.8, 0.6), isSuccess);
+    const GridMap lazySubmap = constLazyMap.getSubmap(map.getPosition(), Length(0.8, 0.6), isLazySuccess);
+    ASSERT_TRUE(isSuccess);
+    ASSERT_TRUE(isLazySuccess);
+    for (GridMapIterator iterator(submap); !iterator.isPastEnd(); ++iterator) {
+      const float value = submap.at("other", *iterator);
+      const float lazyValue = lazySubmap.at("other", *iterator);
+      EXPECT_TRUE((std::isnan(value) && std::isnan(lazyValue)) || value == lazyValue);
+    }
+  }
+
+  // The data is cleared on flush.
+  lazyMap.flush();
+  for (const auto& layer : map.getLayers()) {
+    const Matrix& data = map.get(layer);
+    const Matrix& lazyData = constLazyMap.get(layer);
+    for (int i = 0; i < data.size(); ++i) {
+      EXPECT_TRUE((std::isnan(data(i)) && std::isnan(lazyData(i))) || data(i) == lazyData(i));
+    }
+  }
+}
+
+TEST(GridMap, LazyClearingConstAccess)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(1.0, 1.0), 0.1);
+  map["layer"].setConstant(1.0);
+  map.setLazyClearing(true);
+  std::vector<BufferRegion> newRegions;
+  map.move(Position(0.3, 0.0), newRegions);
+  ASSERT_FALSE(newRegions.empty());
+  const Index index = newRegions[0].getStartIndex();
+  GridMap copy = map;
+
+  // Const access reads the dropped cells as invalid, but does not clear them and does not copy the data.
+  const GridMap& constMap = map;
+  EXPECT_TRUE(std::isnan(constMap.get("layer")(index(0), index(1))));
+  EXPECT_TRUE(std::isnan(constMap["layer"](index(0), index(1))));
+  EXPECT_TRUE(std::isnan(constMap.at("layer", index)));
+  EXPECT_TRUE(std::isnan(LayerView(map, "layer")(index(0), index(1))));
+  EXPECT_TRUE(map.hasStaleRegions("layer"));
+  EXPECT_TRUE(map.isShared("layer", copy));
+  // The map was moved along x, the row after the dropped rows is kept.
+  const Index otherIndex((index(0) + newRegions[0].getSize()(0)) % map.getSize()(0), index(1));
+  EXPECT_EQ(1.0, constMap.get("layer")(otherIndex(0), otherIndex(1)));
+  EXPECT_EQ(1.0, LayerView(map, "layer")(otherIndex(0), otherIndex(1)));
+
+  // Flushing copies the data, the copy keeps its own pending regions.
+  map.flush();
+  EXPECT_FALSE(map.hasStaleRegions("layer"));
+  EXPECT_TRUE(std::isnan(constMap.get("layer")(index(0), index(1))));
+  EXPECT_FALSE(map.isShared("layer", copy));
+  const GridMap& constCopy = copy;
+  EXPECT_TRUE(copy.hasStaleRegions("layer"));
+  EXPECT_TRUE(std::isnan(constCopy.get("layer")(index(0), index(1))));
+  EXPECT_TRUE(std::isnan(constCopy.at("layer", index)));
+
+  // Compact layers are masked as well.
+  copy.setStorageType("layer", StorageType::Float16);
+  copy.move(Position(0.6, 0.0));
+  EXPECT_TRUE(copy.hasStaleRegions("layer"));
+  EXPECT_TRUE(std::isnan(LayerView(copy, "layer")(index(0), index(1))));
+  EXPECT_TRUE(std::isnan(constCopy.get("layer")(index(0), index(1))));
+}
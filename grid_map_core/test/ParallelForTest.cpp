@@ -0,0 +1,93 @@
+/*
+ * ParallelForTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ */
+
+#include "grid_map_core/GridMap.hpp"
+#include "grid_map_core/GridMapMath.hpp"
+#include "grid_map_core/ParallelFor.hpp"
+#include "grid_map_core/ThreadPool.hpp"
+
+// gtest
+#include <gtest/gtest.h>
+
+// STL
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace grid_map;
+
+TEST(ThreadPool, RunsEachTaskOnce)
+{
+  ThreadPool threadPool(4);
+  EXPECT_EQ(4u, threadPool.getNumberOfThreads());
+  std::vector<std::atomic<int>> counts(1000);
+  for (auto& count : counts) count = 0;
+  threadPool.parallelFor(counts.size(), [&](size_t i) { counts[i] += 1; });
+  for (const auto& count : counts) EXPECT_EQ(1, count);
+
+  // The pool can be reused and runs empty loops.
+  threadPool.parallelFor(0, [&](size_t i) { counts[i] += 1; });
+  threadPool.parallelFor(counts.size(), [&](size_t i) { counts[i] += 1; });
+  for (const auto& count : counts) EXPECT_EQ(2, count);
+}
+
+TEST(ThreadPool, RethrowsException)
+{
+  ThreadPool threadPool(3);
+  std::atomic<int> nTasks(0);
+  EXPECT_THROW(threadPool.parallelFor(100, [&](size_t i) {
+    nTasks += 1;
+    if (i == 42) throw std::runtime_error("task failed");
+  }), std::runtime_error);
+  EXPECT_EQ(100, nTasks);
+}
+
+TEST(ParallelFor, SpansCoverSubmap)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(3.0, 2.0), 0.1);
+  map.move(Position(0.75, -0.45)); // Wrap the circular buffer.
+  ThreadPool threadPool(4);
+
+  // Submap that wraps around the end of the buffer in both directions.
+  Index submapStartIndex = map.getStartIndex() + Index(2, 5);
+  mapIndexWithinRange(submapStartIndex, map.getSize());
+  const Size submapSize(20, 12);
+  Eigen::MatrixXi counts = Eigen::MatrixXi::Zero(map.getSize()(0), map.getSize()(1));
+  std::mutex mutex;
+  EXPECT_TRUE(parallelForEachSpan(map, submapStartIndex, submapSize, [&](const BufferRegion& span) {
+    std::lock_guard<std::mutex> lock(mutex);
+    counts.block(span.getStartIndex()(0), span.getStartIndex()(1), span.getSize()(0), span.getSize()(1)).array() += 1;
+  }, threadPool));
+
+  // Every cell of the submap is visited exactly once, no other cell is visited.
+  for (int i = 0; i < submapSize(0); ++i) {
+    for (int j = 0; j < submapSize(1); ++j) {
+      const int row = (submapStartIndex(0) + i) % map.getSize()(0);
+      const int col = (submapStartIndex(1) + j) % map.getSize()(1);
+      EXPECT_EQ(1, counts(row, col));
+      counts(row, col) = 0;
+    }
+  }
+  EXPECT_EQ(0, counts.sum());
+}
+
+TEST(ParallelFor, EachCell)
+{
+  GridMap map({"layer"});
+  map.setGeometry(Length(2.0, 1.0), 0.1);
+  map.move(Position(-0.35, 0.25));
+  ThreadPool threadPool(4);
+
+  Matrix& data = map["layer"];
+  data.setZero();
+  parallelForEachCell(map, [&](const Index& index) { data(index(0), index(1)) += 1.0; }, threadPool);
+  EXPECT_EQ(data.size(), data.sum());
+  EXPECT_EQ(1.0, data.maxCoeff());
+}
@@ -0,0 +1,104 @@
+/*
+ * AsyncLogger.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+namespace map_fitter {
+
+enum class LogLevel
+{
+  Info,
+  Warning,
+  Error
+};
+
+/*!
+ * Writes log records on a background thread, so the matching does not block on the console.
+ * Records with the same key can be rate limited, the number of suppressed records is added
+ * to the next written one. If the queue is full, records are dropped and counted.
+ */
+class AsyncLogger
+{
+public:
+    /*!
+     * Get the logger of the process.
+     * @return the logger.
+     */
+    static AsyncLogger& instance();
+
+    /*!
+     * Destructor, writes the remaining records.
+     */
+    virtual ~AsyncLogger();
+
+    /*!
+     * Queues a record, info goes to std::cout, warnings and errors to std::cerr.
+     * @param level the level of the record.
+     * @param key identifies the kind of record, e.g. "match" or "reinit SAD".
+     * @param message the message, may span several lines.
+     * @param minimumInterval records with the same key within this interval are suppressed [s].
+     */
+    void log(LogLevel level, const std::string& key, const std::string& message, double minimumInterval = 0.0);
+
+    /*!
+     * Waits until all queued records are written.
+     */
+    void flush();
+
+    /*!
+     * Sets the number of records that can be queued.
+     * @param capacity the number of records.
+     */
+    void setCapacity(size_t capacity);
+
+private:
+    AsyncLogger();
+
+    struct Record
+    {
+      LogLevel level;
+      std::string key;
+      std::string message;
+      size_t suppressed;
+    };
+
+    //! Rate limit of a key.
+    struct KeyState
+    {
+      std::chrono::steady_clock::time_point lastWritten;
+      size_t suppressed = 0;
+    };
+
+    void writer();
+
+    std::deque<Record> queue_;
+    size_t capacity_;
+    size_t dropped_;
+    bool writing_;
+    bool stop_;
+    std::map<std::string, KeyState> keys_;
+
+    std::mutex mutex_;
+    std::condition_variable queueCondition_;
+    std::condition_variable emptyCondition_;
+    std::thread thread_;
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * GridMapBinaryConverter.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef GRIDMAPBINARYCONVERTER_H
+#define GRIDMAPBINARYCONVERTER_H
+
+#include <grid_map_core/GridMap.hpp>
+#include <string>
+
+
+namespace map_fitter {
+
+/*!
+ * Reads and writes grid maps as binary files, without ROS.
+ * The file holds the geometry, frame, timestamp and the layers as column-major floats
+ * in the order of the circular buffer (the start index is kept).
+ */
+class GridMapBinaryConverter
+{
+public:
+    /*!
+     * Saves a grid map to a binary file.
+     * @param map the grid map.
+     * @param path the path of the file.
+     * @return true if successful.
+     */
+    static bool saveToFile(const grid_map::GridMap& map, const std::string& path);
+
+    /*!
+     * Loads a grid map from a binary file.
+     * @param path the path of the file.
+     * @param[out] map the grid map.
+     * @return true if successful.
+     */
+    static bool loadFromFile(const std::string& path, grid_map::GridMap& map);
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * LatencyStatistics.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef LATENCYSTATISTICS_H
+#define LATENCYSTATISTICS_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace map_fitter {
+
+/*!
+ * Percentiles of the durations of a stage [s].
+ */
+struct StagePercentiles
+{
+  std::string stage;
+  //! Number of durations in the window and in total.
+  size_t count = 0;
+  size_t totalCount = 0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+};
+
+/*!
+ * Rolling window of the durations of the processing stages, from which the percentiles
+ * are computed. Durations can be added and read from different threads.
+ */
+class LatencyStatistics
+{
+public:
+    /*!
+     * Constructor.
+     * @param windowSize the number of durations kept per stage.
+     */
+    LatencyStatistics(size_t windowSize = 500);
+
+    /*!
+     * Adds the duration of a stage, the oldest duration is dropped if the window is full.
+     * @param stage the name of the stage.
+     * @param duration the duration [s].
+     */
+    void add(const std::string& stage, double duration);
+
+    /*!
+     * Adds the durations of several stages.
+     * @param durations the durations [s] by stage.
+     */
+    void add(const std::map<std::string, double>& durations);
+
+    /*!
+     * Get the percentiles of all stages, sorted by the name of the stage.
+     * @return the percentiles.
+     */
+    std::vector<StagePercentiles> getPercentiles() const;
+
+    /*!
+     * Removes all durations.
+     */
+    void clear();
+
+private:
+    //! Durations of a stage, a ring buffer once the window is full.
+    struct Window
+    {
+      std::vector<double> durations;
+      size_t next = 0;
+      size_t totalCount = 0;
+    };
+
+    size_t windowSize_;
+
+    std::map<std::string, Window> windows_;
+
+    mutable std::mutex mutex_;
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * LatestMailbox.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef LATESTMAILBOX_H
+#define LATESTMAILBOX_H
+
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <cstddef>
+
+namespace map_fitter {
+
+/*!
+ * Single-slot mailbox between a producer and a consumer thread.
+ * A new item replaces the pending one ("latest wins"), replaced items are counted as dropped.
+ * The consumer is busy from take() until it calls done() or takes the next item.
+ */
+template<typename T>
+class LatestMailbox
+{
+public:
+    LatestMailbox() : hasItem_(false), isBusy_(false), isClosed_(false), numberOfPosted_(0), numberOfDropped_(0) {}
+
+    /*!
+     * Posts an item, replacing the pending item if there is one.
+     * @param item the item.
+     * @return true if a pending item has been dropped.
+     */
+    bool post(T item)
+    {
+      bool dropped;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dropped = hasItem_;
+        item_ = std::move(item);
+        hasItem_ = true;
+        ++numberOfPosted_;
+        if (dropped) { ++numberOfDropped_; }
+      }
+      condition_.notify_one();
+      return dropped;
+    }
+
+    /*!
+     * Posts an item only if no item is pending and the consumer is not busy with a taken item.
+     * @param item the item.
+     * @return true if the item has been posted.
+     */
+    bool tryPost(T item)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (hasItem_ || isBusy_) { return false; }
+        item_ = std::move(item);
+        hasItem_ = true;
+        ++numberOfPosted_;
+      }
+      condition_.notify_one();
+      return true;
+    }
+
+    /*!
+     * Waits for an item and takes it out of the mailbox.
+     * @param item the item.
+     * @return false if the mailbox has been closed.
+     */
+    bool take(T& item)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      isBusy_ = false;
+      condition_.wait(lock, [this] { return hasItem_ || isClosed_; });
+      if (isClosed_) { return false; }
+      item = std::move(item_);
+      item_ = T();
+      hasItem_ = false;
+      isBusy_ = true;
+      return true;
+    }
+
+    /*!
+     * Marks the taken item as processed, such that tryPost() accepts items again.
+     */
+    void done()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      isBusy_ = false;
+    }
+
+    /*!
+     * Closes the mailbox and wakes up the consumer, pending items are discarded.
+     */
+    void close()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isClosed_ = true;
+      }
+      condition_.notify_all();
+    }
+
+    //! Number of posted items.
+    size_t getNumberOfPosted() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return numberOfPosted_;
+    }
+
+    //! Number of items that were replaced before they were taken.
+    size_t getNumberOfDropped() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return numberOfDropped_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    T item_;
+    bool hasItem_;
+    bool isBusy_;
+    bool isClosed_;
+    size_t numberOfPosted_;
+    size_t numberOfDropped_;
+};
+
+} /* namespace */
+
+#endif
@@ -11,21 +11,42 @@
 #define MAPFITTER_H
 
 #include <ros/ros.h>
-#include <cstdlib>
-#include <math.h>
 #include <tf/tf.h>
-#include <tf/transform_broadcaster.h>
 #include <tf/transform_listener.h>
-#include <grid_map_core/GridMap.hpp>
-#include <grid_map_core/iterators/GridMapIterator.hpp>
-#include <grid_map_core/iterators/SubmapIteratorSparse.hpp>
+#include <tf2_ros/static_transform_broadcaster.h>
 #include <grid_map_ros/GridMapRosConverter.hpp>
 #include <grid_map_msgs/GridMap.h>
 #include <geometry_msgs/PointStamped.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <std_srvs/Trigger.h>
+#include <map_fitter/MatchingResult.h>
+#include <map_fitter/StageLatencyArray.h>
+#include <map_fitter/LatestMailbox.h>
+#include <map_fitter/MapFitterCore.h>
+#include <map_fitter/LatencyStatistics.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 
 namespace map_fitter {
 
+/*!
+ * Admission policy for the received maps.
+ * - KeepLatest: a newer map replaces the map waiting to be matched.
+ * - DropWhileBusy: maps received while matching (or while a map is waiting) are dropped.
+ * - EveryNth: only every n-th received map is admitted, then as KeepLatest.
+ */
+enum class AdmissionPolicy
+{
+  KeepLatest,
+  DropWhileBusy,
+  EveryNth
+};
+
 class MapFitter
 {
 public:
@@ -44,33 +65,50 @@ public:
    	 * Callback function for the grid map.
    	 * @param message the grid map message to be visualized.
    	 */
-  	void callback(const grid_map_msgs::GridMap& message);
+  	void callback(const grid_map_msgs::GridMapConstPtr& message);
 
-    void exhaustiveSearch(grid_map::Index submap_start_index, grid_map::Size submap_size);
-
-    void iterateParticles(std::string score, int subresolution, grid_map::Matrix& data, grid_map::Matrix& variance_data, grid_map::Matrix& reference_data, std::vector<float>& scores, grid_map::GridMap& correlationMap, grid_map::Position& shift);
-    void calculateSimilarity(bool success, std::string score, grid_map::Index index, int theta, std::vector<float>& scores, grid_map::GridMap& correlationMap, grid_map::Position& shift);
-
-    void publishPoint(std::string score, std::vector<float>& bestPos, grid_map::Position& shift, ros::Time pubTime);
-    void cumErrorAndCorrMatches(std::string score, std::vector<float> bestPos);
-
-    void resample(std::string score, std::vector<float> bestPos, std::vector<float> scores, std::normal_distribution<float>& distribution, int subresolution);
+    /*!
+     * Matches a grid map to the reference map (runs on the matching thread).
+     * @param message the grid map message to be matched.
+     * @return true if a matching result was published.
+     */
+    bool processMap(const grid_map_msgs::GridMapConstPtr& message);
 
-    std::vector<float> findBestPos(std::string score, std::vector<float> scores, int subresolution);
-    float findZ(grid_map::Matrix& data, grid_map::Matrix& reference_data, float x, float y, int theta);
-    bool findMatches(grid_map::Matrix& data, grid_map::Matrix& variance_data, grid_map::Matrix& reference_data, float row, float col, float sin_theta, float cos_theta, bool equal);
+    /*!
+     * Callback function for the reference map (reference set "topic").
+     * @param message the reference grid map message.
+     */
+    void referenceCallback(const grid_map_msgs::GridMapConstPtr& message);
 
-    float errorSAD();
-    float weightedErrorSAD();
+    /*!
+     * Takes the geometry of the template map from a message and adopts the
+     * elevation and variance layers in place, without copying them.
+     * @param message the grid map message.
+     * @return true if successful.
+     */
+    bool adoptMap(const grid_map_msgs::GridMapConstPtr& message);
 
-    float errorSSD();
-    float weightedErrorSSD();
+    /*!
+     * Adopts a layer of the template map message. Column-major layers are used in
+     * place, other layouts are copied.
+     * @param layer the name of the layer.
+     * @param[out] data the data of the layer.
+     * @param copy the storage for the data if it has to be copied.
+     * @return true if successful.
+     */
+    bool adoptLayer(const std::string& layer, const float*& data, grid_map::Matrix& copy);
 
-    float correlationNCC();
-    float weightedCorrelationNCC();
+    /*!
+     * Passes the latest received reference map to the matching if it changed.
+     * @return true if a reference map has been received.
+     */
+    bool updateReferenceFromTopic();
 
-    float mutualInformation();
-    float normalizedMutualInformation();   
+    /*!
+     * Matches the adopted template map with the prior pose from tf and publishes the result.
+     * @return true if a matching result was published.
+     */
+    bool matchMap();
 
 private:
     /*!
@@ -79,19 +117,44 @@ private:
      */
     bool readParameters();
 
-    bool initialization();
+    /*!
+     * Publishes the identity transform from map to grid_map once as a static transform.
+     */
+    void broadcastGridMapFrame();
+
+    /*!
+     * Publishes the ground truth position on /correctPoint (z is the yaw in degrees).
+     * @param position the transform from map to base.
+     */
+    void publishCorrectPoint(const tf::StampedTransform& position);
+
+    /*!
+     * Matching thread, takes the latest received map out of the mailbox and matches it.
+     */
+    void matchingWorker();
+
+    /*!
+     * Correlation thread, serializes and publishes the latest correlation map.
+     */
+    void correlationWorker();
 
     /*!
-     * Check if visualizations are active (subscribed to),
-     * and accordingly cancels/activates the subscription to the
-     * grid map to safe bandwidth.
-     * @param timerEvent the timer event.
+     * Prints how many maps were received, accepted, matched and dropped.
      */
-    void updateSubscriptionCallback(const ros::TimerEvent& timerEvent);
+    void printAdmissionMetrics() const;
 
-    void tfBroadcast(const ros::TimerEvent& timerEvent);
+    /*!
+     * Publishes the latency percentiles of the stages on /diagnostics and the statistics topic.
+     */
+    void publishStatistics(const ros::WallTimerEvent& event);
 
-    void tfListener(const ros::TimerEvent& timerEvent);
+    /*!
+     * Writes the recorded trace events to the trace file as Chrome trace JSON.
+     * @param request the empty request.
+     * @param response if the trace has been written.
+     * @return true.
+     */
+    bool dumpTrace(std_srvs::Trigger::Request& request, std_srvs::Trigger::Response& response);
 
 
     //! ROS nodehandle.
@@ -106,66 +169,105 @@ private:
 
     std::string correlationMapTopic_;
 
-    //! Duration of checking the activity of the visualizations.
-    ros::Duration activityCheckDuration_;
+    //! Topic name of the matching results.
+    std::string resultTopic_;
 
-    //! Timer to check the activity of the visualizations.
-    ros::Timer activityCheckTimer_;
+    //! Topic name of the latency statistics.
+    std::string statisticsTopic_;
 
-    ros::Timer broadcastTimer_;
-    ros::Timer listenerTimer_;
+    //! Time when matching of the current map started (monotonic).
+    std::chrono::steady_clock::time_point processingStartTime_;
 
-    //! If the grid map visualization is subscribed to the grid map.
-    bool isActive_;
+    //! Rolling latency percentiles of the processing stages.
+    LatencyStatistics statistics_;
 
+    //! Rate of the latency statistics [Hz].
+    double statisticsRate_;
 
-    std::string set_;
+    //! Hardware counters of the scoring since the last statistics, by stage.
+    std::map<std::string, KernelCounters> kernelCounters_;
+    std::mutex kernelCountersMutex_;
+
+    //! Timer of the latency statistics, on wall time so it runs with simulated time as well.
+    ros::WallTimer statisticsTimer_;
+
+    //! File of the Chrome trace, written on request and on shutdown if tracing is enabled.
+    std::string traceFile_;
+
+    //! Service writing the Chrome trace.
+    ros::ServiceServer dumpTraceService_;
+
+    //! Admission policy for the received maps.
+    AdmissionPolicy admissionPolicy_;
+
+    //! Admit every n-th map (EveryNth policy).
+    int admissionEveryNth_;
+
+    //! Number of received maps.
+    std::atomic<size_t> numberOfReceivedMaps_;
+
+    //! Number of maps rejected by the admission policy.
+    std::atomic<size_t> numberOfRejectedMaps_;
 
-    bool weighted_;
+    //! Number of matched maps.
+    std::atomic<size_t> numberOfMatchedMaps_;
 
-    bool resample_;
+    //! Latest received map, waiting to be matched.
+    LatestMailbox<grid_map_msgs::GridMapConstPtr> mapMailbox_;
 
-    bool SAD_; 
-    bool SSD_;
-    bool NCC_;
-    bool MI_;
+    //! Thread running the matching.
+    std::thread matchingThread_;
 
-    bool initializeSAD_;
-    bool initializeSSD_;
-    bool initializeNCC_;
-    bool initializeMI_;
+    //! Latest correlation map, waiting to be published.
+    LatestMailbox<std::shared_ptr<const grid_map::GridMap>> correlationMailbox_;
+
+    //! Thread publishing the correlation map.
+    std::thread correlationThread_;
+
+
+    //! Reference map: set1 or set2 (recorded bags) or topic (latest map on the reference map topic).
+    std::string set_;
+
+    //! Matching of the template maps to the reference map.
+    MapFitterCore core_;
 
     
     //! ROS subscriber to the grid map.
     ros::Subscriber mapSubscriber_;
 
-    //! Template grid_map
+    //! Template grid_map (geometry only, the layers stay in the message).
     grid_map::GridMap map_;
 
-    //! Reference grid_map
-    grid_map::GridMap referenceMap_;
+    //! Message of the template map that is matched.
+    grid_map_msgs::GridMapConstPtr mapMessage_;
 
+    //! Elevation and variance of the template map.
+    const float* mapElevation_;
+    const float* mapVariance_;
 
-    int angleIncrement_;
-    int searchIncrement_;
-    int correlationIncrement_;   
+    //! Copies of the template layers, if they could not be adopted in place.
+    grid_map::Matrix mapElevationCopy_;
+    grid_map::Matrix mapVarianceCopy_;
 
-    float requiredOverlap_;
+    //! Reference grid_map
+    grid_map::GridMap referenceMap_;
 
-    float NCCThreshold_;
-    float SSDThreshold_;
-    float SADThreshold_;
-    float MIThreshold_;
+    //! ROS subscriber to the reference map (reference set "topic").
+    ros::Subscriber referenceSubscriber_;
 
+    //! Latest received reference map and the one passed to the matching.
+    grid_map_msgs::GridMapConstPtr referenceMessage_;
+    grid_map_msgs::GridMapConstPtr matchedReferenceMessage_;
+    std::mutex referenceMutex_;
 
-    tf::TransformBroadcaster broadcaster_;
-    tf::TransformListener listener_;
+    //! Reference map of the recorded sets ("set1", "set2") and the submap the particles are initialized in.
+    grid_map_msgs::GridMapConstPtr loadedReferenceMessage_;
+    grid_map::Index searchStartIndex_;
+    grid_map::Size searchSize_;
 
 
-    float map_min_;
-    float map_max_;
-    float reference_min_;
-    float reference_max_;
+    tf2_ros::StaticTransformBroadcaster staticBroadcaster_;
+    tf::TransformListener listener_;
 
 
     //! Grid map publisher.
@@ -173,64 +275,13 @@ private:
 
     ros::Publisher referencePublisher_;
 
-    ros::Publisher NCCPointPublisher_;
-    ros::Publisher SSDPointPublisher_;
-    ros::Publisher SADPointPublisher_;
-    ros::Publisher MIPointPublisher_;
-    ros::Publisher correctPointPublisher_;
-
+    //! Publisher of the matching results.
+    ros::Publisher resultPublisher_;
 
-    float cumulativeErrorNCC_;
-    float cumulativeErrorSSD_;
-    float cumulativeErrorSAD_;
-    float cumulativeErrorMI_;
-    int correctMatchesNCC_;
-    int correctMatchesSSD_;
-    int correctMatchesSAD_;
-    int correctMatchesMI_;
-
-    float shifted_mean_;
-    float reference_mean_;
-    int matches_;
-    std::vector<float> xy_shifted_;
-    std::vector<float> xy_reference_;
-    std::vector<float> xy_shifted_var_;
-    std::vector<float> xy_reference_var_;
-
-    float templateRotation_;
-    grid_map::Position map_position_;
-    std::default_random_engine generator_;
-
-    std::vector<int> particleRowSAD_;
-    std::vector<int> particleColSAD_;
-    std::vector<int> particleThetaSAD_;
-
-    std::vector<int> particleRowSSD_;
-    std::vector<int> particleColSSD_;
-    std::vector<int> particleThetaSSD_;
-
-    std::vector<int> particleRowNCC_;
-    std::vector<int> particleColNCC_;
-    std::vector<int> particleThetaNCC_;
-
-    std::vector<int> particleRowMI_;
-    std::vector<int> particleColMI_;
-    std::vector<int> particleThetaMI_;
-
-    int noneSAD_ = 10;
-    int noneSSD_ = 10;
-    int noneNCC_ = -1;
-    int noneMI_ = 0;
-
-    float rhoSAD_;
-    float rhoSSD_;
-    float rhoNCC_;
-    float rhoMI_;
-
-    int numberOfParticles_;
-
-    ros::Duration duration1_;
-    ros::Duration duration2_;
+    //! Publishers of the latency statistics.
+    ros::Publisher diagnosticsPublisher_;
+    ros::Publisher statisticsPublisher_;
+    ros::Publisher correctPointPublisher_;
 };
 
 } /* namespace */
@@ -0,0 +1,562 @@
+/*
+ * MapFitterCore.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef MAPFITTERCORE_H
+#define MAPFITTERCORE_H
+
+#include <cstdlib>
+#include <math.h>
+#include <grid_map_core/GridMap.hpp>
+#include <grid_map_core/GridMapMath.hpp>
+#include <grid_map_core/iterators/GridMapIterator.hpp>
+#include <grid_map_core/iterators/SubmapIteratorSparse.hpp>
+#include <grid_map_core/ParallelFor.hpp>
+#include <grid_map_core/ThreadPool.hpp>
+#include <grid_map_core/LayerView.hpp>
+#include <map_fitter/AsyncLogger.h>
+#include <map_fitter/PerfCounters.h>
+#include <Eigen/Core>
+#include <chrono>
+#include <map>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace map_fitter {
+
+//! Read-only view of a template layer that is stored outside of a grid map.
+typedef Eigen::Map<const grid_map::Matrix> ConstMatrixMap;
+
+/*!
+ * Parameters of the matching.
+ */
+struct MapFitterParameters
+{
+  //! If the metrics are weighted with the variance of the template map.
+  bool weighted = true;
+
+  //! If the particles are resampled after each match.
+  bool resample = true;
+
+  //! Enabled metrics.
+  bool SAD = true;
+  bool SSD = true;
+  bool NCC = true;
+  bool MI = true;
+
+  //! Angle between the initial particles [deg].
+  int angleIncrement = 5;
+
+  //! Distance between the initial particles [cells].
+  int searchIncrement = 5;
+
+  //! Distance between the compared template cells [cells].
+  int correlationIncrement = 5;
+
+  //! Part of the template cells that have to overlap with the reference map.
+  float requiredOverlap = 0.25;
+
+  //! Reinitialize a particle filter if its best score is worse than the threshold.
+  float SADThreshold = 0.05;
+  float SSDThreshold = 0.008;
+  float NCCThreshold = 0.6;
+  float MIThreshold = 0;
+
+  //! Temperature of the particle weights exp(score/rho).
+  float rhoSAD = -0.0025;
+  float rhoSSD = -0.0004;
+  float rhoNCC = 0.025;
+  float rhoMI = 0.015;
+
+  //! Number of drawn particles when resampling, the maximum if the number is adaptive (at least 1).
+  int numberOfParticles = 4000;
+
+  //! If the number of drawn particles follows the number of occupied (row, col, theta) bins (KLD-sampling).
+  bool adaptiveParticles = true;
+
+  //! Minimum number of drawn particles if the number is adaptive (at least 1).
+  int minimumNumberOfParticles = 200;
+
+  //! Size of the bins of the particle positions [m] and orientations [deg].
+  double kldBinSize = 0.2;
+  double kldAngleBinSize = 3.0;
+
+  //! Bound on the KL divergence between the sampled and the true posterior and the upper standard normal quantile of its confidence (2.33 for 99%).
+  double kldEpsilon = 0.05;
+  double kldQuantile = 2.33;
+
+  //! Storage type of the reference elevation.
+  grid_map::StorageType referenceStorageType = grid_map::StorageType::Float32;
+
+  //! Step size of the ScaledInt16 reference elevation, zero to fit the range of the data [m].
+  double referenceStorageResolution = 0.0;
+
+  //! If the scores and particle counts of each match are printed.
+  bool verbose = true;
+
+  //! Minimum interval between the reinitialization messages of a metric [s].
+  double logInterval = 1.0;
+
+  //! If hardware performance counters are read around the scoring of each metric (Linux only).
+  bool perfCounters = false;
+
+  //! If a metric switches to tracking once its particle cloud converged.
+  bool tracking = true;
+
+  //! The cloud converged if the standard deviations of its position [m] and orientation [deg] are below these.
+  double trackingPositionSpread = 0.5;
+  double trackingAngleSpread = 5.0;
+
+  //! Number of drawn particles (at least 1) and distance between the compared template cells [cells] when tracking.
+  int trackingParticles = 1000;
+  int trackingCorrelationIncrement = 2;
+
+  //! Particles further than this from the best particle are dropped when tracking [m], [deg].
+  double trackingWindow = 1.0;
+  double trackingAngleWindow = 15.0;
+
+  //! Tracking stops if the best score gets worse by this fraction of the score when it started.
+  double trackingScoreDrop = 0.5;
+
+  //! If a failed metric is first reinitialized around its last good estimate and the prior before searching globally.
+  bool localReinitialization = true;
+
+  //! Half size of the position [m] and orientation [deg] window of the local reinitialization.
+  double recoveryWindow = 3.0;
+  double recoveryAngleWindow = 45.0;
+};
+
+/*!
+ * Hardware counters of a scoring kernel, with the number of scored particles and compared template cells.
+ */
+struct KernelCounters
+{
+  PerfCounterValues counters;
+  double particles = 0;
+  double cells = 0;
+};
+
+/*!
+ * Prior pose of the template map in the frame of the reference map.
+ */
+struct PriorPose
+{
+  double x = 0.0;
+  double y = 0.0;
+  //! Yaw [rad].
+  double yaw = 0.0;
+};
+
+/*!
+ * Pose estimate of one metric.
+ */
+struct MatchEstimate
+{
+  //! Metric (SAD, SSD, NCC or MI).
+  std::string metric;
+
+  //! False if no particle had enough overlap.
+  bool valid = false;
+
+  //! Position [m] and orientation [deg] of the template map.
+  double x = 0.0;
+  double y = 0.0;
+  double theta = 0.0;
+
+  //! Height offset between the template and the reference map [m].
+  double z = 0.0;
+
+  //! Score of the best particle.
+  double score = 0.0;
+
+  //! Covariance of the particles (x, y, theta).
+  Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+};
+
+/*!
+ * Matches template grid maps to a reference grid map with one particle filter per metric.
+ * Depends on grid_map_core only, all ROS handling is done by MapFitter.
+ */
+class MapFitterCore
+{
+public:
+    /*!
+     * Constructor.
+     * @param parameters the parameters of the matching.
+     */
+    MapFitterCore(const MapFitterParameters& parameters = MapFitterParameters());
+
+    /*!
+     * Destructor.
+     */
+    virtual ~MapFitterCore();
+
+    /*!
+     * Sets the parameters and reinitializes the particle filters.
+     * The numbers of drawn particles are raised to at least one.
+     * @param parameters the parameters of the matching.
+     */
+    void setParameters(const MapFitterParameters& parameters);
+
+    /*!
+     * Get the parameters.
+     * @return the parameters of the matching.
+     */
+    const MapFitterParameters& getParameters() const;
+
+    /*!
+     * Sets the reference map (with an elevation layer). The layers are shared, not copied.
+     * @param referenceMap the reference map.
+     * @param searchStartIndex the start index of the submap the particles are initialized in.
+     * @param searchSize the size of the submap the particles are initialized in.
+     */
+    void setReferenceMap(const grid_map::GridMap& referenceMap, const grid_map::Index& searchStartIndex, const grid_map::Size& searchSize);
+
+    /*!
+     * Sets the reference map, the particles are initialized where it has elevation data.
+     * @param referenceMap the reference map.
+     */
+    void setReferenceMap(const grid_map::GridMap& referenceMap);
+
+    /*!
+     * Matches a template map (with elevation and variance layers) to the reference map.
+     * @param templateMap the template map.
+     * @param prior the prior pose of the template map.
+     * @param[out] estimates the estimates of the enabled metrics.
+     * @return true if successful.
+     */
+    bool match(const grid_map::GridMap& templateMap, const PriorPose& prior, std::vector<MatchEstimate>& estimates);
+
+    /*!
+     * Matches a template map whose layers are stored outside of the grid map.
+     * @param templateGeometry the geometry (size, position and start index) of the template map.
+     * @param elevation the column-major elevation of the template map.
+     * @param variance the column-major variance of the template map.
+     * @param prior the prior pose of the template map.
+     * @param[out] estimates the estimates of the enabled metrics.
+     * @return true if successful.
+     */
+    bool match(const grid_map::GridMap& templateGeometry, const float* elevation, const float* variance, const PriorPose& prior, std::vector<MatchEstimate>& estimates);
+
+    /*!
+     * Enables the computation of the correlation map, it covers the particles only.
+     * @param computeCorrelationMap if the correlation map is computed.
+     */
+    void setComputeCorrelationMap(bool computeCorrelationMap);
+
+    /*!
+     * Get the correlation map of the last match.
+     * @return the correlation map, nullptr if it has not been computed.
+     */
+    std::shared_ptr<const grid_map::GridMap> getCorrelationMap() const;
+
+    /*!
+     * Reinitializes the particle filters of the enabled metrics with the next match.
+     */
+    void reset();
+
+    /*!
+     * Get the summed position error of the best particles of a metric w.r.t. the prior poses.
+     * @param metric the metric (SAD, SSD, NCC or MI).
+     * @return the cumulative error [m].
+     */
+    float getCumulativeError(const std::string& metric) const;
+
+    /*!
+     * If a metric is tracking, i.e. its particle cloud converged and it is matched in a window around the estimate.
+     * @param metric the metric (SAD, SSD, NCC or MI).
+     * @return true if tracking.
+     */
+    bool isTracking(const std::string& metric) const;
+
+    /*!
+     * Get the number of matches of a metric that agree with the prior pose.
+     * @param metric the metric (SAD, SSD, NCC or MI).
+     * @return the number of correct matches.
+     */
+    int getNumberOfCorrectMatches(const std::string& metric) const;
+
+    /*!
+     * Get the durations of the stages of the last match, measured with a monotonic clock:
+     * initialization or prediction of the particles, scoring per metric, best_pos, z_alignment,
+     * resampling and the total.
+     * @return the durations [s] by stage.
+     */
+    const std::map<std::string, double>& getStageDurations() const;
+
+    /*!
+     * Get the hardware counters of the scoring of the last match (parameter perfCounters),
+     * by stage as in getStageDurations(). Empty if the counters are not available.
+     * @return the counters by stage.
+     */
+    const std::map<std::string, KernelCounters>& getKernelCounters() const;
+
+    void exhaustiveSearch(const ConstMatrixMap& data, const ConstMatrixMap& variance_data, const PriorPose& prior, std::vector<MatchEstimate>& estimates);
+
+    /*!
+     * Places particles of the metrics to be initialized on the search submap of the reference map,
+     * every searchIncrement cells and angleIncrement degrees.
+     * @param subresolution the subresolution of the particles.
+     */
+    void initializeParticles(int subresolution);
+
+    /*!
+     * Places the particles of a failed metric in a window around the pose predicted by the prior
+     * and around its last good estimate relative to the prior, every searchIncrement cells and angleIncrement degrees.
+     * The steps are doubled until there are at most numberOfParticles particles.
+     * @param score the metric.
+     * @param subresolution the subresolution of the particles.
+     * @return false if no particles were placed because the prior is outside of the reference map.
+     */
+    bool initializeLocalParticles(const std::string& score, int subresolution);
+
+    //! Removes all particles of a metric.
+    void clearParticles(const std::string& score);
+
+    void iterateParticles(std::string score, int subresolution, const ConstMatrixMap& data, const ConstMatrixMap& variance_data, const grid_map::LayerView& reference_data, std::vector<float>& scores, grid_map::GridMap& correlationMap, grid_map::Position& shift);
+    /*!
+     * Sets the geometry of the correlation map to the bounding box of the particles.
+     * @param correlationMap the correlation map.
+     * @param shift the shift of the correlation map w.r.t. the reference map.
+     * @param subresolution the subresolution of the particles.
+     * @return false if there are no particles.
+     */
+    bool setCorrelationMapGeometry(grid_map::GridMap& correlationMap, const grid_map::Position& shift, int subresolution);
+
+    void calculateSimilarity(bool success, std::string score, grid_map::Index index, int theta, std::vector<float>& scores, grid_map::GridMap& correlationMap, grid_map::Position& shift);
+
+    /*!
+     * Adds the estimate of a metric with the covariance of its particles.
+     * @param score the metric.
+     * @param bestPos the best particle (x, y, theta, score).
+     * @param z the height offset.
+     * @param shift the shift of the template map w.r.t. its true position.
+     * @param subresolution the subresolution of the particles.
+     * @param estimates the estimates to add the estimate to.
+     */
+    void addEstimate(std::string score, std::vector<float>& bestPos, float z, grid_map::Position& shift, int subresolution, std::vector<MatchEstimate>& estimates);
+    void cumErrorAndCorrMatches(std::string score, std::vector<float> bestPos);
+
+    void resample(std::string score, std::vector<float> bestPos, std::vector<float> scores, std::normal_distribution<float>& distribution, int subresolution);
+
+    /*!
+     * Number of particles that bounds the KL divergence between the sampled and the true posterior (KLD-sampling).
+     * @param numberOfBins the number of occupied bins.
+     * @param epsilon the bound on the KL divergence.
+     * @param quantile the upper standard normal quantile of the confidence.
+     * @return the number of particles.
+     */
+    static int kldNumberOfParticles(size_t numberOfBins, double epsilon, double quantile);
+
+    /*!
+     * Finds the particle with the best score of a metric.
+     * @param score the metric.
+     * @param scores the scores of the particles.
+     * @param subresolution the subresolution of the particles.
+     * @return the best particle (x, y, theta, score), with the none score of the metric if there are no particles.
+     */
+    std::vector<float> findBestPos(std::string score, std::vector<float> scores, int subresolution);
+    float findZ(const ConstMatrixMap& data, const grid_map::LayerView& reference_data, float x, float y, int theta);
+    bool findMatches(const ConstMatrixMap& data, const ConstMatrixMap& variance_data, const grid_map::LayerView& reference_data, float row, float col, float sin_theta, float cos_theta, bool equal);
+
+    float errorSAD();
+    float weightedErrorSAD();
+
+    float errorSSD();
+    float weightedErrorSSD();
+
+    float correlationNCC();
+    float weightedCorrelationNCC();
+
+    float mutualInformation();
+    float normalizedMutualInformation();
+
+protected:
+    //! Parameters of the matching.
+    MapFitterParameters parameters_;
+
+    //! Printouts of the current match, written as one record by the AsyncLogger if verbose.
+    std::stringbuf logBuffer_;
+
+    //! Output of the per-match printouts (logBuffer_ if verbose, discarded otherwise).
+    std::ostream log_;
+
+    bool weighted_;
+
+    bool resample_;
+
+    bool SAD_;
+    bool SSD_;
+    bool NCC_;
+    bool MI_;
+
+    bool initializeSAD_;
+    bool initializeSSD_;
+    bool initializeNCC_;
+    bool initializeMI_;
+
+    //! If the correlation map is requested.
+    bool correlationMapRequested_;
+
+    //! If the correlation map is computed in the current match (requested and there are particles).
+    bool computeCorrelationMap_;
+
+    //! Correlation map of the last match.
+    std::shared_ptr<const grid_map::GridMap> correlationMap_;
+
+    //! Template grid_map (the layers may be stored outside of the map).
+    grid_map::GridMap map_;
+
+    //! Reference grid_map
+    grid_map::GridMap referenceMap_;
+
+    //! Reference map as it was set (sharing its layers), to detect if it changed.
+    grid_map::GridMap referenceSource_;
+
+    //! Submap of the reference map the particles are initialized in.
+    grid_map::Index searchStartIndex_;
+    grid_map::Size searchSize_;
+
+
+    int angleIncrement_;
+    int searchIncrement_;
+    int correlationIncrement_;
+
+    float requiredOverlap_;
+
+    float NCCThreshold_;
+    float SSDThreshold_;
+    float SADThreshold_;
+    float MIThreshold_;
+
+
+    float map_min_;
+    float map_max_;
+    float reference_min_;
+    float reference_max_;
+
+
+    float cumulativeErrorNCC_;
+    float cumulativeErrorSSD_;
+    float cumulativeErrorSAD_;
+    float cumulativeErrorMI_;
+    int correctMatchesNCC_;
+    int correctMatchesSSD_;
+    int correctMatchesSAD_;
+    int correctMatchesMI_;
+
+    float shifted_mean_;
+    float reference_mean_;
+    int matches_;
+    std::vector<float> xy_shifted_;
+    std::vector<float> xy_reference_;
+    std::vector<float> xy_shifted_var_;
+    std::vector<float> xy_reference_var_;
+
+    float templateRotation_;
+    grid_map::Position map_position_;
+    //! Random numbers of the resampling and the prediction, per instance such that matchers in several threads are independent.
+    std::default_random_engine generator_;
+
+    std::vector<int> particleRowSAD_;
+    std::vector<int> particleColSAD_;
+    std::vector<int> particleThetaSAD_;
+
+    std::vector<int> particleRowSSD_;
+    std::vector<int> particleColSSD_;
+    std::vector<int> particleThetaSSD_;
+
+    std::vector<int> particleRowNCC_;
+    std::vector<int> particleColNCC_;
+    std::vector<int> particleThetaNCC_;
+
+    std::vector<int> particleRowMI_;
+    std::vector<int> particleColMI_;
+    std::vector<int> particleThetaMI_;
+
+    //! Number of drawn particles in the same state, each state is scored once.
+    std::vector<int> particleCountSAD_;
+    std::vector<int> particleCountSSD_;
+    std::vector<int> particleCountNCC_;
+    std::vector<int> particleCountMI_;
+
+    int noneSAD_ = 10;
+    int noneSSD_ = 10;
+    int noneNCC_ = -1;
+    int noneMI_ = 0;
+
+    float rhoSAD_;
+    float rhoSSD_;
+    float rhoNCC_;
+    float rhoMI_;
+
+    int numberOfParticles_;
+
+    /*!
+     * Adds the time since start to the duration of a stage of the current match.
+     * @param stage the name of the stage.
+     * @param start the start of the stage.
+     */
+    void addStageDuration(const std::string& stage, const std::chrono::steady_clock::time_point& start);
+
+    //! Durations of the stages of the last match [s].
+    std::map<std::string, double> stageDurations_;
+
+    /*!
+     * Starts the hardware counters of a scoring kernel, they are opened for the calling thread on first use.
+     */
+    void startKernelCounters();
+
+    /*!
+     * Stops the hardware counters and adds them to a stage of the current match.
+     * @param stage the name of the stage.
+     * @param numberOfParticles the number of scored particles.
+     */
+    void stopKernelCounters(const std::string& stage, size_t numberOfParticles);
+
+    //! Hardware counters of the calling thread, nullptr until the first use.
+    std::unique_ptr<PerfCounters> perfCounters_;
+
+    //! Hardware counters of the scoring of the last match.
+    std::map<std::string, KernelCounters> kernelCounters_;
+
+    /*!
+     * Sets the distance between the compared template cells for the scoring of a metric.
+     * @param score the metric.
+     * @param numberOfParticles the number of particles of the metric.
+     */
+    void setCorrelationIncrement(const std::string& score, size_t numberOfParticles);
+
+    /*!
+     * Starts tracking a metric if its resampled particle cloud converged, stops it if the best score degraded.
+     * @param score the metric.
+     * @param bestPos the best particle of the last match (x, y, theta, score).
+     * @param subresolution the subresolution of the particles.
+     */
+    void updateTracking(const std::string& score, const std::vector<float>& bestPos, int subresolution);
+
+    //! If a metric is tracking.
+    std::map<std::string, bool> tracking_;
+
+    //! Best score of a metric when it started tracking.
+    std::map<std::string, float> trackingScore_;
+
+    //! Recovery stage of a metric: 0 localized, 1 reinitialized locally, 2 reinitialized globally.
+    std::map<std::string, int> recoveryTier_;
+
+    //! Offset of the last good best particle from the particle of the prior (row, col, theta) [subresolution cells], [deg].
+    std::map<std::string, std::vector<int> > recoveryOffset_;
+};
+
+} /* namespace */
+
+#endif
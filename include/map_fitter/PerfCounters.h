@@ -0,0 +1,116 @@
+/*
+ * PerfCounters.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+
+namespace map_fitter {
+
+/*!
+ * Hardware events counted around the scoring kernels.
+ */
+enum PerfCounter
+{
+  Cycles = 0,
+  Instructions,
+  L1DataMisses,
+  LastLevelCacheMisses,
+  BranchMisses,
+  NumberOfPerfCounters
+};
+
+/*!
+ * Counts of the hardware events, scaled if the counters were multiplexed.
+ */
+struct PerfCounterValues
+{
+  std::array<double, NumberOfPerfCounters> values;
+  //! False for the events that could not be counted.
+  std::array<bool, NumberOfPerfCounters> valid;
+
+  PerfCounterValues()
+  {
+    values.fill(0.0);
+    valid.fill(false);
+  }
+
+  PerfCounterValues& operator+=(const PerfCounterValues& other)
+  {
+    for (int i = 0; i < NumberOfPerfCounters; i++)
+    {
+      values[i] += other.values[i];
+      valid[i] = valid[i] || other.valid[i];
+    }
+    return *this;
+  }
+};
+
+/*!
+ * Hardware performance counters of the calling thread, read with Linux perf_event_open.
+ * Events that are not supported (or not permitted, see /proc/sys/kernel/perf_event_paranoid)
+ * are left out, without any counter isAvailable() is false and start/stop do nothing.
+ */
+class PerfCounters
+{
+public:
+    /*!
+     * Constructor, opens the counters for the calling thread (user space only).
+     */
+    PerfCounters();
+
+    /*!
+     * Destructor, closes the counters.
+     */
+    virtual ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /*!
+     * @return true if at least one counter could be opened.
+     */
+    bool isAvailable() const;
+
+    /*!
+     * @return why no counter could be opened, empty if available.
+     */
+    const std::string& getError() const;
+
+    /*!
+     * Resets and starts the counters.
+     */
+    void start();
+
+    /*!
+     * Stops the counters and reads them.
+     * @return the counts since start().
+     */
+    PerfCounterValues stop();
+
+    /*!
+     * Get the name of an event.
+     * @param counter the event.
+     * @return the name.
+     */
+    static const char* getName(int counter);
+
+private:
+    //! File descriptors of the counters, -1 if not available.
+    std::array<int, NumberOfPerfCounters> fileDescriptors_;
+
+    std::string error_;
+};
+
+} /* namespace */
+
+#endif
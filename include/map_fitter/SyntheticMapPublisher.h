@@ -0,0 +1,91 @@
+/*
+ * SyntheticMapPublisher.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef SYNTHETICMAPPUBLISHER_H
+#define SYNTHETICMAPPUBLISHER_H
+
+#include <ros/ros.h>
+#include <tf/tf.h>
+#include <tf/transform_broadcaster.h>
+#include <grid_map_ros/GridMapRosConverter.hpp>
+#include <grid_map_msgs/GridMap.h>
+#include <geometry_msgs/PointStamped.h>
+#include <map_fitter/TerrainGenerator.h>
+#include <memory>
+
+
+namespace map_fitter {
+
+/*!
+ * Stand-in for the mapping nodes: publishes a synthetic reference map and a stream of
+ * template maps along a trajectory, with the prior pose on tf and the ground truth on a topic.
+ */
+class SyntheticMapPublisher
+{
+public:
+    /*!
+     * Constructor.
+     * @param nodeHandle the ROS node handle.
+     */
+    SyntheticMapPublisher(ros::NodeHandle& nodeHandle);
+
+    /*!
+     * Destructor.
+     */
+    virtual ~SyntheticMapPublisher();
+
+private:
+    /*!
+     * Read parameters from ROS.
+     * @return true if successful.
+     */
+    bool readParameters();
+
+    /*!
+     * Publishes the next template map with its prior pose and ground truth.
+     */
+    void publishFrame(const ros::TimerEvent& event);
+
+    //! ROS nodehandle.
+    ros::NodeHandle& nodeHandle_;
+
+    //! Topic names of the template maps and the reference map.
+    std::string mapTopic_;
+    std::string referenceMapTopic_;
+
+    //! Rate of the template maps [Hz].
+    double rate_;
+
+    //! Number of template maps to publish, 0 publishes until shutdown.
+    int numberOfFrames_;
+
+    //! Number of the next template map.
+    int frame_;
+
+    //! Parameters of the generator.
+    TerrainParameters terrainParameters_;
+    TemplateParameters templateParameters_;
+
+    //! Generator of the reference map and the template maps.
+    std::unique_ptr<TerrainGenerator> generator_;
+
+    //! Timer of the template maps.
+    ros::Timer timer_;
+
+    //! Broadcasts the prior pose from map to base.
+    tf::TransformBroadcaster broadcaster_;
+
+    //! Publishers of the template maps, the latched reference map and the ground truth (z is the yaw in degrees).
+    ros::Publisher mapPublisher_;
+    ros::Publisher referencePublisher_;
+    ros::Publisher groundTruthPublisher_;
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * TerrainGenerator.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef TERRAINGENERATOR_H
+#define TERRAINGENERATOR_H
+
+#include <map_fitter/MapFitterCore.h>
+#include <grid_map_core/GridMap.hpp>
+#include <random>
+
+
+namespace map_fitter {
+
+/*!
+ * Parameters of the procedural reference map.
+ */
+struct TerrainParameters
+{
+  //! Side length of the reference map [m].
+  double length = 20.0;
+
+  //! Resolution of the reference map [m].
+  double resolution = 0.05;
+
+  //! Fractal terrain: height, size of the largest features [m], octaves and amplitude ratio between octaves.
+  double fractalHeight = 1.0;
+  double fractalScale = 8.0;
+  int fractalOctaves = 5;
+  double fractalPersistence = 0.5;
+
+  //! Number and height of straight terrain steps [m].
+  int numberOfSteps = 3;
+  double stepHeight = 0.2;
+
+  //! Number of buildings, their side length range and height range [m].
+  int numberOfBuildings = 6;
+  double buildingMinSize = 1.0;
+  double buildingMaxSize = 3.0;
+  double buildingMinHeight = 1.0;
+  double buildingMaxHeight = 4.0;
+
+  //! Number of circular holes without data and their maximum radius [m].
+  int numberOfHoles = 4;
+  double holeMaxRadius = 1.0;
+
+  //! Seed of the random generator, the same seed gives the same terrain.
+  unsigned int seed = 1;
+};
+
+/*!
+ * Parameters of the template maps extracted along a simulated trajectory.
+ */
+struct TemplateParameters
+{
+  //! Side length of the template maps [m].
+  double length = 3.0;
+
+  //! Speed along the trajectory [m/s] and rate of the template maps [Hz].
+  double speed = 0.5;
+  double rate = 2.0;
+
+  //! Height offset of the template maps w.r.t. the reference map [m].
+  double heightOffset = 0.5;
+
+  //! Standard deviation of the elevation noise at the center and its increase per meter of distance [m].
+  double noise = 0.01;
+  double noisePerMeter = 0.01;
+
+  //! Number of occluded sectors (shadows behind obstacles), their angle [deg] and the distance they start at [m].
+  int numberOfOccludedSectors = 1;
+  double occludedSectorAngle = 30.0;
+  double occlusionDistance = 0.5;
+
+  //! Standard deviation of the prior position [m] and heading [deg] w.r.t. the ground truth.
+  double priorPositionNoise = 0.0;
+  double priorHeadingNoise = 0.0;
+
+  //! Constant offset of the prior position w.r.t. the ground truth, like a drifted odometry frame [m].
+  double priorOffsetX = 0.0;
+  double priorOffsetY = 0.0;
+
+  //! Seed of the random generator.
+  unsigned int seed = 2;
+};
+
+/*!
+ * Template map with its ground truth and prior pose.
+ */
+struct SyntheticFrame
+{
+  //! Template map (elevation and variance), positioned at the prior position.
+  grid_map::GridMap map;
+
+  //! Ground truth pose of the template map.
+  PriorPose groundTruth;
+
+  //! Prior pose of the template map, the ground truth with noise.
+  PriorPose prior;
+};
+
+/*!
+ * Generates procedural reference maps and a stream of template maps along a trajectory,
+ * to run and evaluate the matching without recorded data.
+ */
+class TerrainGenerator
+{
+public:
+    /*!
+     * Constructor.
+     * @param terrainParameters the parameters of the reference map.
+     * @param templateParameters the parameters of the template maps.
+     */
+    TerrainGenerator(const TerrainParameters& terrainParameters = TerrainParameters(),
+                     const TemplateParameters& templateParameters = TemplateParameters());
+
+    /*!
+     * Destructor.
+     */
+    virtual ~TerrainGenerator();
+
+    /*!
+     * Get the reference map (elevation layer), it is generated in the constructor.
+     * @return the reference map.
+     */
+    const grid_map::GridMap& getReferenceMap() const;
+
+    /*!
+     * Get the ground truth pose on the trajectory, an ellipse inside the reference map
+     * with the heading along the trajectory.
+     * @param frame the number of the template map.
+     * @return the pose.
+     */
+    PriorPose getTrajectoryPose(int frame) const;
+
+    /*!
+     * Extracts the template map of a frame. The template map is seen from the prior pose:
+     * it is positioned at the prior position and rotated by the heading error.
+     * @param frame the number of the template map.
+     * @return the template map with its ground truth and prior pose.
+     */
+    SyntheticFrame generateFrame(int frame);
+
+    /*!
+     * Extracts a template map at a given pose.
+     * @param groundTruth the true pose of the template map.
+     * @param prior the prior pose of the template map.
+     * @param[out] templateMap the template map.
+     */
+    void extractTemplate(const PriorPose& groundTruth, const PriorPose& prior, grid_map::GridMap& templateMap);
+
+private:
+    /*!
+     * Fractal value noise in [-1, 1].
+     * @param x the x coordinate [m].
+     * @param y the y coordinate [m].
+     * @return the noise value.
+     */
+    double fractalNoise(double x, double y) const;
+
+    /*!
+     * Value noise on the integer lattice in [-1, 1].
+     */
+    double valueNoise(double x, double y, int octave) const;
+
+    void generateReferenceMap();
+
+    //! Parameters of the reference map.
+    TerrainParameters terrainParameters_;
+
+    //! Parameters of the template maps.
+    TemplateParameters templateParameters_;
+
+    //! Reference map.
+    grid_map::GridMap referenceMap_;
+
+    //! Random generator of the template maps.
+    std::default_random_engine generator_;
+};
+
+} /* namespace */
+
+#endif
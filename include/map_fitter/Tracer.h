@@ -0,0 +1,147 @@
+/*
+ * Tracer.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace map_fitter {
+
+/*!
+ * Records scoped events of the matching into a ring buffer per thread and writes them
+ * as Chrome trace JSON (chrome://tracing, Perfetto). Disabled, an event costs one atomic load.
+ * Each thread only writes its own buffer, without locking.
+ */
+class Tracer
+{
+public:
+    /*!
+     * Get the tracer of the process.
+     * @return the tracer.
+     */
+    static Tracer& instance();
+
+    /*!
+     * Enables or disables the recording of events.
+     * @param enabled if events are recorded.
+     */
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const
+    {
+      return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * Sets the number of events kept per thread, for the threads that record their first event afterwards.
+     * @param bufferSize the number of events.
+     */
+    void setBufferSize(size_t bufferSize);
+
+    /*!
+     * Names the calling thread in the trace.
+     * @param name the name of the thread.
+     */
+    void setThreadName(const std::string& name);
+
+    /*!
+     * Records a complete event of the calling thread.
+     * @param name the name of the event, must be a string literal (only the pointer is kept).
+     * @param start the start of the event.
+     * @param end the end of the event.
+     */
+    void record(const char* name, const std::chrono::steady_clock::time_point& start, const std::chrono::steady_clock::time_point& end);
+
+    /*!
+     * Writes the events in the buffers as Chrome trace JSON, the events are kept.
+     * @param path the path of the file.
+     * @return true if successful.
+     */
+    bool writeChromeTrace(const std::string& path) const;
+
+private:
+    Tracer();
+
+    //! Event, times in nanoseconds since the start of the tracer.
+    struct Event
+    {
+      const char* name;
+      int64_t start;
+      int64_t duration;
+    };
+
+    //! Slot of a ring buffer, atomic such that it can be copied while its thread writes it.
+    struct EventSlot
+    {
+      std::atomic<const char*> name;
+      std::atomic<int64_t> start;
+      std::atomic<int64_t> duration;
+    };
+
+    //! Ring buffer of one thread, written by this thread only.
+    struct ThreadBuffer
+    {
+      std::unique_ptr<EventSlot[]> events;
+      size_t size;
+      std::atomic<uint64_t> written;
+      int threadId;
+      std::string threadName;
+    };
+
+    ThreadBuffer& threadBuffer();
+
+    std::atomic<bool> enabled_;
+
+    size_t bufferSize_;
+
+    std::chrono::steady_clock::time_point startTime_;
+
+    //! Buffers of all threads, they are kept until the end of the process.
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    //! Protects the list of buffers and the thread names.
+    mutable std::mutex mutex_;
+};
+
+/*!
+ * Records an event from its construction to its destruction, if the tracer is enabled.
+ */
+class TraceScope
+{
+public:
+    /*!
+     * Constructor.
+     * @param name the name of the event, must be a string literal.
+     */
+    explicit TraceScope(const char* name)
+        : name_(Tracer::instance().isEnabled() ? name : nullptr)
+    {
+      if (name_ != nullptr) { start_ = std::chrono::steady_clock::now(); }
+    }
+
+    ~TraceScope()
+    {
+      if (name_ != nullptr) { Tracer::instance().record(name_, start_, std::chrono::steady_clock::now()); }
+    }
+
+private:
+    const char* name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * AsyncLogger.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/AsyncLogger.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace map_fitter {
+
+AsyncLogger& AsyncLogger::instance()
+{
+  static AsyncLogger logger;
+  return logger;
+}
+
+AsyncLogger::AsyncLogger()
+    : capacity_(1024), dropped_(0), writing_(false), stop_(false)
+{
+  thread_ = std::thread(&AsyncLogger::writer, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  queueCondition_.notify_one();
+  if (thread_.joinable()) { thread_.join(); }
+}
+
+void AsyncLogger::log(LogLevel level, const std::string& key, const std::string& message, double minimumInterval)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    KeyState& state = keys_[key];
+    if (minimumInterval > 0 && state.lastWritten.time_since_epoch().count() != 0
+        && std::chrono::duration<double>(now - state.lastWritten).count() < minimumInterval)
+    {
+      state.suppressed += 1;
+      return;
+    }
+    if (queue_.size() >= capacity_)
+    {
+      dropped_ += 1;
+      return;
+    }
+    state.lastWritten = now;
+    queue_.push_back(Record{level, key, message, state.suppressed});
+    state.suppressed = 0;
+  }
+  queueCondition_.notify_one();
+}
+
+void AsyncLogger::flush()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  emptyCondition_.wait(lock, [this]() { return queue_.empty() && !writing_; });
+}
+
+void AsyncLogger::setCapacity(size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = std::max<size_t>(capacity, 1);
+}
+
+void AsyncLogger::writer()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    queueCondition_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty() && stop_) { break; }
+
+    std::deque<Record> records;
+    records.swap(queue_);
+    size_t dropped = dropped_;
+    dropped_ = 0;
+    writing_ = true;
+    lock.unlock();
+
+    // one write per stream and batch of records, flushed once
+    std::ostringstream info, warnings;
+    for (const Record& record : records)
+    {
+      std::ostream& stream = record.level == LogLevel::Info ? static_cast<std::ostream&>(info) : static_cast<std::ostream&>(warnings);
+      stream << (record.level == LogLevel::Info ? "[INFO] " : record.level == LogLevel::Warning ? "[WARN] " : "[ERROR] ") << "[" << record.key << "] " << record.message;
+      if (record.message.empty() || record.message.back() != '\n') { stream << "\n"; }
+      if (record.suppressed > 0) { stream << "  (" << record.suppressed << " similar records suppressed)\n"; }
+    }
+    if (dropped > 0) { warnings << "[WARN] [logger] " << dropped << " records dropped, the queue was full\n"; }
+    if (!info.str().empty()) { std::cout << info.str() << std::flush; }
+    if (!warnings.str().empty()) { std::cerr << warnings.str() << std::flush; }
+
+    lock.lock();
+    writing_ = false;
+    if (queue_.empty()) { emptyCondition_.notify_all(); }
+  }
+  writing_ = false;
+  emptyCondition_.notify_all();
+}
+
+} /* namespace */
@@ -0,0 +1,129 @@
+/*
+ * GridMapBinaryConverter.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/GridMapBinaryConverter.h>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+namespace map_fitter {
+
+//! Identifies the file format and its version.
+static const char binaryMagic[4] = {'G', 'M', 'B', '1'};
+
+template<typename T>
+static void writeValue(std::ofstream& file, const T& value)
+{
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool readValue(std::ifstream& file, T& value)
+{
+  return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static void writeString(std::ofstream& file, const std::string& value)
+{
+  writeValue(file, uint32_t(value.size()));
+  file.write(value.data(), value.size());
+}
+
+static bool readString(std::ifstream& file, std::string& value)
+{
+  uint32_t length;
+  if (!readValue(file, length) || length > 4096) { return false; }
+  value.resize(length);
+  return length == 0 || static_cast<bool>(file.read(&value[0], length));
+}
+
+bool GridMapBinaryConverter::saveToFile(const grid_map::GridMap& map, const std::string& path)
+{
+  std::ofstream file(path, std::ios::binary);
+  if (!file)
+  {
+    std::cerr << "Could not open " << path << " for writing." << std::endl;
+    return false;
+  }
+  file.write(binaryMagic, sizeof(binaryMagic));
+  writeValue(file, double(map.getResolution()));
+  writeValue(file, double(map.getLength()(0)));
+  writeValue(file, double(map.getLength()(1)));
+  writeValue(file, double(map.getPosition()(0)));
+  writeValue(file, double(map.getPosition()(1)));
+  writeValue(file, int32_t(map.getSize()(0)));
+  writeValue(file, int32_t(map.getSize()(1)));
+  writeValue(file, int32_t(map.getStartIndex()(0)));
+  writeValue(file, int32_t(map.getStartIndex()(1)));
+  writeValue(file, uint64_t(map.getTimestamp()));
+  writeString(file, map.getFrameId());
+  writeValue(file, uint32_t(map.getLayers().size()));
+  for (const std::string& layer : map.getLayers())
+  {
+    const grid_map::Matrix& data = map.get(layer);
+    writeString(file, layer);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+  }
+  return static_cast<bool>(file);
+}
+
+bool GridMapBinaryConverter::loadFromFile(const std::string& path, grid_map::GridMap& map)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+  {
+    std::cerr << "Could not open " << path << " for reading." << std::endl;
+    return false;
+  }
+  char magic[sizeof(binaryMagic)];
+  if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, binaryMagic, sizeof(magic)) != 0)
+  {
+    std::cerr << path << " is not a binary grid map." << std::endl;
+    return false;
+  }
+
+  double resolution, lengthX, lengthY, positionX, positionY;
+  int32_t rows, cols, startRow, startCol;
+  uint64_t timestamp;
+  std::string frameId;
+  uint32_t numberOfLayers;
+  if (!readValue(file, resolution) || !readValue(file, lengthX) || !readValue(file, lengthY) || !readValue(file, positionX) || !readValue(file, positionY)
+      || !readValue(file, rows) || !readValue(file, cols) || !readValue(file, startRow) || !readValue(file, startCol)
+      || !readValue(file, timestamp) || !readString(file, frameId) || !readValue(file, numberOfLayers))
+  {
+    std::cerr << path << " has an invalid header." << std::endl;
+    return false;
+  }
+
+  map = grid_map::GridMap();
+  map.setGeometry(grid_map::Length(lengthX, lengthY), resolution, grid_map::Position(positionX, positionY));
+  if (map.getSize()(0) != rows || map.getSize()(1) != cols)
+  {
+    std::cerr << path << " has an inconsistent size." << std::endl;
+    return false;
+  }
+  map.setStartIndex(grid_map::Index(startRow, startCol));
+  map.setTimestamp(timestamp);
+  map.setFrameId(frameId);
+
+  for (uint32_t i = 0; i < numberOfLayers; i++)
+  {
+    std::string layer;
+    grid_map::Matrix data(rows, cols);
+    if (!readString(file, layer) || !file.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(float)))
+    {
+      std::cerr << path << " is truncated." << std::endl;
+      return false;
+    }
+    map.add(layer, data);
+  }
+  return true;
+}
+
+} /* namespace */
@@ -0,0 +1,73 @@
+/*
+ * LatencyStatistics.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/LatencyStatistics.h>
+#include <algorithm>
+#include <cmath>
+
+namespace map_fitter {
+
+/*!
+ * Nearest-rank percentile, reorders the durations.
+ */
+static double percentile(std::vector<double>& durations, double fraction)
+{
+  size_t rank = size_t(std::ceil(fraction * durations.size()));
+  size_t index = rank > 0 ? rank - 1 : 0;
+  std::nth_element(durations.begin(), durations.begin() + index, durations.end());
+  return durations[index];
+}
+
+LatencyStatistics::LatencyStatistics(size_t windowSize)
+    : windowSize_(std::max<size_t>(windowSize, 1))
+{
+}
+
+void LatencyStatistics::add(const std::string& stage, double duration)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Window& window = windows_[stage];
+  if (window.durations.size() < windowSize_) { window.durations.push_back(duration); }
+  else { window.durations[window.next] = duration; }
+  window.next = (window.next + 1) % windowSize_;
+  window.totalCount += 1;
+}
+
+void LatencyStatistics::add(const std::map<std::string, double>& durations)
+{
+  for (const auto& duration : durations) { add(duration.first, duration.second); }
+}
+
+std::vector<StagePercentiles> LatencyStatistics::getPercentiles() const
+{
+  std::vector<StagePercentiles> percentiles;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& window : windows_)
+  {
+    if (window.second.durations.empty()) { continue; }
+    std::vector<double> durations = window.second.durations;
+    StagePercentiles stage;
+    stage.stage = window.first;
+    stage.count = durations.size();
+    stage.totalCount = window.second.totalCount;
+    stage.max = *std::max_element(durations.begin(), durations.end());
+    stage.p99 = percentile(durations, 0.99);
+    stage.p95 = percentile(durations, 0.95);
+    stage.p50 = percentile(durations, 0.50);
+    percentiles.push_back(stage);
+  }
+  return percentiles;
+}
+
+void LatencyStatistics::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  windows_.clear();
+}
+
+} /* namespace */
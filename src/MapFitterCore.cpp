@@ -0,0 +1,1538 @@
+/*
+ * MapFitterCore.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/MapFitterCore.h>
+#include <map_fitter/Tracer.h>
+#include <iostream>
+#include <numeric>
+#include <functional>
+#include <algorithm>
+#include <array>
+#include <set>
+
+namespace map_fitter {
+
+MapFitterCore::MapFitterCore(const MapFitterParameters& parameters)
+    : log_(nullptr), correlationMapRequested_(false), computeCorrelationMap_(false), templateRotation_(0), map_position_(0, 0)
+{
+  setParameters(parameters);
+
+  cumulativeErrorNCC_ = 0;
+  cumulativeErrorSSD_ = 0;
+  cumulativeErrorSAD_ = 0;
+  cumulativeErrorMI_ = 0;
+  correctMatchesNCC_ = 0;
+  correctMatchesSSD_ = 0;
+  correctMatchesSAD_ = 0;
+  correctMatchesMI_ = 0;
+}
+
+MapFitterCore::~MapFitterCore()
+{
+}
+
+void MapFitterCore::setParameters(const MapFitterParameters& parameters)
+{
+  parameters_ = parameters;
+  // at least one particle is drawn, an empty particle set has no estimate to resample from
+  parameters_.numberOfParticles = std::max(1, parameters.numberOfParticles);
+  parameters_.minimumNumberOfParticles = std::max(1, parameters.minimumNumberOfParticles);
+  parameters_.trackingParticles = std::max(1, parameters.trackingParticles);
+  log_.rdbuf(parameters.verbose ? &logBuffer_ : nullptr);
+  weighted_ = parameters.weighted;
+  resample_ = parameters.resample;
+
+  SAD_ = parameters.SAD;
+  SSD_ = parameters.SSD;
+  NCC_ = parameters.NCC;
+  MI_ = parameters.MI;
+
+  rhoSAD_ = parameters.rhoSAD;
+  rhoSSD_ = parameters.rhoSSD;
+  rhoNCC_ = parameters.rhoNCC;
+  rhoMI_ = parameters.rhoMI;
+  numberOfParticles_ = parameters_.numberOfParticles;
+
+  angleIncrement_ = parameters.angleIncrement;
+  searchIncrement_ = parameters.searchIncrement;
+  correlationIncrement_ = parameters.correlationIncrement;
+  requiredOverlap_ = parameters.requiredOverlap;
+
+  SADThreshold_ = parameters.SADThreshold;
+  SSDThreshold_ = parameters.SSDThreshold;
+  NCCThreshold_ = parameters.NCCThreshold;
+  MIThreshold_ = parameters.MIThreshold;
+
+  reset();
+}
+
+const MapFitterParameters& MapFitterCore::getParameters() const
+{
+  return parameters_;
+}
+
+void MapFitterCore::setReferenceMap(const grid_map::GridMap& referenceMap, const grid_map::Index& searchStartIndex, const grid_map::Size& searchSize)
+{
+  searchStartIndex_ = searchStartIndex;
+  searchSize_ = searchSize;
+
+  // the same reference map is not copied and encoded again
+  if (referenceSource_.isShared("elevation", referenceMap) && (referenceSource_.getSize() == referenceMap.getSize()).all()
+      && (referenceSource_.getStartIndex() == referenceMap.getStartIndex()).all() && referenceSource_.getPosition() == referenceMap.getPosition()
+      && referenceSource_.getResolution() == referenceMap.getResolution() && referenceMap_.getStorageType("elevation") == parameters_.referenceStorageType)
+  {
+    return;
+  }
+  referenceSource_ = referenceMap;
+  referenceMap_ = referenceMap;
+
+  // compact reference elevation halves the memory traffic of the matching
+  if (parameters_.referenceStorageType != grid_map::StorageType::Float32)
+  {
+    referenceMap_.setStorageType("elevation", parameters_.referenceStorageType, parameters_.referenceStorageResolution);
+  }
+}
+
+void MapFitterCore::setReferenceMap(const grid_map::GridMap& referenceMap)
+{
+  grid_map::GridMap map = referenceMap;
+  grid_map::Index searchStartIndex;
+  grid_map::Size searchSize;
+  map.getDataBoundingSubmap("elevation", searchStartIndex, searchSize);
+  setReferenceMap(map, searchStartIndex, searchSize);
+}
+
+bool MapFitterCore::match(const grid_map::GridMap& templateMap, const PriorPose& prior, std::vector<MatchEstimate>& estimates)
+{
+  if (!templateMap.exists("elevation") || !templateMap.exists("variance"))
+  {
+    std::cerr << "Map fitter needs a template map with elevation and variance layers." << std::endl;
+    return false;
+  }
+  return match(templateMap, templateMap.get("elevation").data(), templateMap.get("variance").data(), prior, estimates);
+}
+
+bool MapFitterCore::match(const grid_map::GridMap& templateGeometry, const float* elevation, const float* variance, const PriorPose& prior, std::vector<MatchEstimate>& estimates)
+{
+  estimates.clear();
+  if (!referenceMap_.exists("elevation"))
+  {
+    std::cerr << "Map fitter has no reference map with an elevation layer." << std::endl;
+    return false;
+  }
+  if (elevation == nullptr || variance == nullptr) { return false; }
+
+  // the layers of the template map are only read during the match
+  map_ = templateGeometry;
+  grid_map::Size size = map_.getSize();
+  const ConstMatrixMap data(elevation, size(0), size(1));
+  const ConstMatrixMap variance_data(variance, size(0), size(1));
+  exhaustiveSearch(data, variance_data, prior, estimates);
+  return true;
+}
+
+void MapFitterCore::setComputeCorrelationMap(bool computeCorrelationMap)
+{
+  correlationMapRequested_ = computeCorrelationMap;
+}
+
+std::shared_ptr<const grid_map::GridMap> MapFitterCore::getCorrelationMap() const
+{
+  return correlationMap_;
+}
+
+void MapFitterCore::reset()
+{
+  initializeSAD_ = SAD_;
+  initializeSSD_ = SSD_;
+  initializeNCC_ = NCC_;
+  initializeMI_ = MI_;
+  particleRowSAD_.clear(); particleColSAD_.clear(); particleThetaSAD_.clear();
+  particleRowSSD_.clear(); particleColSSD_.clear(); particleThetaSSD_.clear();
+  particleRowNCC_.clear(); particleColNCC_.clear(); particleThetaNCC_.clear();
+  particleRowMI_.clear(); particleColMI_.clear(); particleThetaMI_.clear();
+  particleCountSAD_.clear(); particleCountSSD_.clear(); particleCountNCC_.clear(); particleCountMI_.clear();
+  tracking_.clear();
+  trackingScore_.clear();
+  recoveryTier_.clear();
+  recoveryOffset_.clear();
+}
+
+float MapFitterCore::getCumulativeError(const std::string& metric) const
+{
+  if (metric == "SAD") { return cumulativeErrorSAD_; }
+  if (metric == "SSD") { return cumulativeErrorSSD_; }
+  if (metric == "NCC") { return cumulativeErrorNCC_; }
+  if (metric == "MI") { return cumulativeErrorMI_; }
+  return 0;
+}
+
+bool MapFitterCore::isTracking(const std::string& metric) const
+{
+  std::map<std::string, bool>::const_iterator tracking = tracking_.find(metric);
+  return tracking != tracking_.end() && tracking->second;
+}
+
+int MapFitterCore::getNumberOfCorrectMatches(const std::string& metric) const
+{
+  if (metric == "SAD") { return correctMatchesSAD_; }
+  if (metric == "SSD") { return correctMatchesSSD_; }
+  if (metric == "NCC") { return correctMatchesNCC_; }
+  if (metric == "MI") { return correctMatchesMI_; }
+  return 0;
+}
+
+void MapFitterCore::exhaustiveSearch(const ConstMatrixMap& data, const ConstMatrixMap& variance_data, const PriorPose& prior, std::vector<MatchEstimate>& estimates)
+{
+  TraceScope trace("exhaustiveSearch");
+  //initialize parameters
+  grid_map::Size reference_size = referenceMap_.getSize();
+  int rows = reference_size(0);
+  int cols = reference_size(1);
+  float resolution = referenceMap_.getResolution();
+  int subresolution = 1;//resolution / 0.01;
+
+  grid_map::Position previous_position = map_position_;
+  map_position_ = map_.getPosition();
+  grid_map::Position position = referenceMap_.getPosition();
+  grid_map::Size size = map_.getSize();
+  grid_map::Index start_index = map_.getStartIndex();
+  grid_map::Index reference_start_index = referenceMap_.getStartIndex();
+
+  // read-only access keeps the reference layers shared with other copies of the map
+  const grid_map::GridMap& referenceMap = referenceMap_;
+  const grid_map::LayerView reference_data(referenceMap, "elevation");
+
+  float previous_templateRotation = templateRotation_;
+  templateRotation_ = 360.0 - fmod(prior.yaw/M_PI*180+360,360);
+  grid_map::Position shift = grid_map::Position(map_position_(0)-prior.x, map_position_(1)-prior.y);
+
+  std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+  stageDurations_.clear();
+  kernelCounters_.clear();
+  logBuffer_.str("");
+
+  std::normal_distribution<float> distribution(0.0,2.0*subresolution);
+
+  bool initialized_all = initializeSAD_ && initializeSSD_ && initializeNCC_ && initializeMI_;
+  // metrics with new particles skip the prediction, the others still follow the motion of the template
+  bool predictSAD = SAD_ && resample_ && !initializeSAD_;
+  bool predictSSD = SSD_ && resample_ && !initializeSSD_;
+  bool predictNCC = NCC_ && resample_ && !initializeNCC_;
+  bool predictMI = MI_ && resample_ && !initializeMI_;
+  // initialize particles
+  if (initializeSAD_ || initializeSSD_ || initializeNCC_ || initializeMI_)
+  {
+    initializeParticles(subresolution);
+    addStageDuration("initialization", time);
+  }
+  if (predictSAD || predictSSD || predictNCC || predictMI)
+  {
+    std::chrono::steady_clock::time_point predictionTime = std::chrono::steady_clock::now();
+    if (predictSAD)
+    {
+      std::transform(particleRowSAD_.begin(), particleRowSAD_.end(), particleRowSAD_.begin(), std::bind2nd(std::plus<int>(), round( (-(map_position_(0) - previous_position(0)) / resolution + rows)*subresolution + distribution(generator_)/2) ));
+      std::transform(particleRowSAD_.begin(), particleRowSAD_.end(), particleRowSAD_.begin(), std::bind2nd(std::modulus<int>(), rows*subresolution));
+      std::transform(particleColSAD_.begin(), particleColSAD_.end(), particleColSAD_.begin(), std::bind2nd(std::plus<int>(), round( (-(map_position_(1) - previous_position(1)) / resolution + cols)*subresolution + distribution(generator_)/2) ));
+      std::transform(particleColSAD_.begin(), particleColSAD_.end(), particleColSAD_.begin(), std::bind2nd(std::modulus<int>(), cols*subresolution));
+      std::transform(particleThetaSAD_.begin(), particleThetaSAD_.end(), particleThetaSAD_.begin(), std::bind2nd(std::plus<int>(), round( -(templateRotation_ - previous_templateRotation) + 360 + distribution(generator_)/2) ));
+      std::transform(particleThetaSAD_.begin(), particleThetaSAD_.end(), particleThetaSAD_.begin(), std::bind2nd(std::modulus<int>(), 360));
+    }
+    if (predictSSD)
+    {
+      std::transform(particleRowSSD_.begin(), particleRowSSD_.end(), particleRowSSD_.begin(), std::bind2nd(std::plus<int>(), round( (-(map_position_(0) - previous_position(0)) / resolution + rows)*subresolution + distribution(generator_)/2) ));
+      std::transform(particleRowSSD_.begin(), particleRowSSD_.end(), particleRowSSD_.begin(), std::bind2nd(std::modulus<int>(), rows*subresolution));
+      std::transform(particleColSSD_.begin(), particleColSSD_.end(), particleColSSD_.begin(), std::bind2nd(std::plus<int>(), round( (-(map_position_(1) - previous_position(1)) / resolution + cols)*subresolution + distribution(generator_)/2) ));
+      std::transform(particleColSSD_.begin(), particleColSSD_.end(), particleColSSD_.begin(), std::bind2nd(std::modulus<int>(), cols*subresolution));
+      std::transform(particleThetaSSD_.begin(), particleThetaSSD_.end(), particleThetaSSD_.begin(), std::bind2nd(std::plus<int>(), round( -(templateRotation_ - previous_templateRotation) + 360 + distribution(generator_)/2) ));
+      std::transform(particleThetaSSD_.begin(), particleThetaSSD_.end(), particleThetaSSD_.begin(), std::bind2nd(std::modulus<int>(), 360));
+    }
+    if (predictNCC)
+    {
+      std::transform(particleRowNCC_.begin(), particleRowNCC_.end(), particleRowNCC_.begin(), std::bind2nd(std::plus<int>(), round( (-(map_position_(0) - previous_position(0)) / resolution + rows)*subresolution + distribution(generator_)/2) ));
+      std::transform(particleRowNCC_.begin(), particleRowNCC_.end(), particleRowNCC_.begin(), std::bind2nd(std::modulus<int>(), rows*subresolution));
+      std::transform(particleColNCC_.begin(), particleColNCC_.end(), particleColNCC_.begin(), std::bind2nd(std::plus<int>(), round( (-(map_position_(1) - previous_position(1)) / resolution + cols)*subresolution + distribution(generator_)/2) ));
+      std::transform(particleColNCC_.begin(), particleColNCC_.end(), particleColNCC_.begin(), std::bind2nd(std::modulus<int>(), cols*subresolution));
+      std::transform(particleThetaNCC_.begin(), particleThetaNCC_.end(), particleThetaNCC_.begin(), std::bind2nd(std::plus<int>(), round( -(templateRotation_ - previous_templateRotation) + 360 + distribution(generator_)/2) ));
+      std::transform(particleThetaNCC_.begin(), particleThetaNCC_.end(), particleThetaNCC_.begin(), std::bind2nd(std::modulus<int>(), 360));
+    }
+    if (predictMI)
+    {
+      std::transform(particleRowMI_.begin(), particleRowMI_.end(), particleRowMI_.begin(), std::bind2nd(std::plus<int>(), round( (-(map_position_(0) - previous_position(0)) / resolution + rows)*subresolution + distribution(generator_)/2) ));
+      std::transform(particleRowMI_.begin(), particleRowMI_.end(), particleRowMI_.begin(), std::bind2nd(std::modulus<int>(), rows*subresolution));
+      std::transform(particleColMI_.begin(), particleColMI_.end(), particleColMI_.begin(), std::bind2nd(std::plus<int>(), round( (-(map_position_(1) - previous_position(1)) / resolution + cols)*subresolution + distribution(generator_)/2) ));
+      std::transform(particleColMI_.begin(), particleColMI_.end(), particleColMI_.begin(), std::bind2nd(std::modulus<int>(), cols*subresolution));
+      std::transform(particleThetaMI_.begin(), particleThetaMI_.end(), particleThetaMI_.begin(), std::bind2nd(std::plus<int>(), round( -(templateRotation_ - previous_templateRotation) + 360 + distribution(generator_)/2) ));
+      std::transform(particleThetaMI_.begin(), particleThetaMI_.end(), particleThetaMI_.begin(), std::bind2nd(std::modulus<int>(), 360));
+    }
+    addStageDuration("prediction", predictionTime);
+  }
+
+  // correlationMap only covers the particles and is only computed if somebody listens
+  grid_map::GridMap correlationMap({"NCC","rotationNCC","SSD","rotationSSD","SAD","rotationSAD", "MI", "rotationMI"});
+  correlationMap.setFrameId("grid_map");
+  computeCorrelationMap_ = correlationMapRequested_ && setCorrelationMapGeometry(correlationMap, shift, subresolution);
+
+  if ((resample_ || !(SAD_ && SSD_ && NCC_ && MI_)) && !initialized_all)
+  {
+    setCorrelationIncrement("SAD", particleRowSAD_.size());
+    if (SAD_)
+    {
+      std::vector<float> SAD; SAD.clear();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      iterateParticles("SAD",subresolution,data,variance_data,reference_data,SAD,correlationMap,shift);
+      addStageDuration("score_SAD", start);
+
+      start = std::chrono::steady_clock::now();
+      std::vector<float> bestPos; bestPos.clear();
+      bestPos = findBestPos("SAD", SAD, subresolution);
+      addStageDuration("best_pos", start);
+
+      // Calculate z alignement
+      start = std::chrono::steady_clock::now();
+      float z = findZ(data, reference_data, bestPos[0], bestPos[1], bestPos[2]);
+      addStageDuration("z_alignment", start);
+      if (bestPos[3] != noneSAD_) { cumErrorAndCorrMatches("SAD", bestPos); }
+      addEstimate("SAD", bestPos, z, shift, subresolution, estimates);
+      log_ << "Best SAD " << bestPos[3] << " at " << bestPos[0] << ", " << bestPos[1] << " , theta " << bestPos[2] << " and z: " << z << "\n";
+      log_ << "Cumulative error SAD: " << cumulativeErrorSAD_ << " matches: " << correctMatchesSAD_ << "\n";
+
+      if (resample_)
+      {
+        start = std::chrono::steady_clock::now();
+        resample("SAD", bestPos, SAD, distribution, subresolution);
+        addStageDuration("resampling", start);
+      }
+    }
+
+    setCorrelationIncrement("SSD", particleRowSSD_.size());
+    if (SSD_)
+    {
+      std::vector<float> SSD; SSD.clear();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      iterateParticles("SSD",subresolution,data,variance_data,reference_data,SSD,correlationMap,shift);
+      addStageDuration("score_SSD", start);
+
+      start = std::chrono::steady_clock::now();
+      std::vector<float> bestPos; bestPos.clear();
+      bestPos = findBestPos("SSD", SSD, subresolution);
+      addStageDuration("best_pos", start);
+
+      // Calculate z alignement
+      start = std::chrono::steady_clock::now();
+      float z = findZ(data, reference_data, bestPos[0], bestPos[1], bestPos[2]);
+      addStageDuration("z_alignment", start);
+      if (bestPos[3] != noneSSD_) { cumErrorAndCorrMatches("SSD", bestPos); }
+      addEstimate("SSD", bestPos, z, shift, subresolution, estimates);
+      log_ << "Best SSD " << bestPos[3] << " at " << bestPos[0] << ", " << bestPos[1] << " , theta " << bestPos[2] << " and z: " << z << "\n";
+      log_ << "Cumulative error SSD: " << cumulativeErrorSSD_ << " matches: " << correctMatchesSSD_ << "\n";
+
+      if (resample_)
+      {
+        start = std::chrono::steady_clock::now();
+        resample("SSD", bestPos, SSD, distribution, subresolution);
+        addStageDuration("resampling", start);
+      }
+    }
+
+    setCorrelationIncrement("NCC", particleRowNCC_.size());
+    if (NCC_)
+    {
+      std::vector<float> NCC; NCC.clear();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      iterateParticles("NCC",subresolution,data,variance_data,reference_data,NCC,correlationMap,shift);
+
+      addStageDuration("score_NCC", start);
+
+      start = std::chrono::steady_clock::now();
+      std::vector<float> bestPos;
+      bestPos.clear();
+      bestPos = findBestPos("NCC", NCC, subresolution);
+      addStageDuration("best_pos", start);
+
+      // Calculate z alignement
+      start = std::chrono::steady_clock::now();
+      float z = findZ(data, reference_data, bestPos[0], bestPos[1], bestPos[2]);
+      addStageDuration("z_alignment", start);
+      if (bestPos[3] != noneNCC_) { cumErrorAndCorrMatches("NCC", bestPos); }
+      addEstimate("NCC", bestPos, z, shift, subresolution, estimates);
+      log_ << "Best NCC " << bestPos[3] << " at " << bestPos[0] << ", " << bestPos[1] << " , theta " << bestPos[2] << " and z: " << z << "\n";
+      log_ << "Cumulative error NCC: " << cumulativeErrorNCC_ << " matches: " << correctMatchesNCC_ << "\n";
+
+      if (resample_)
+      {
+        start = std::chrono::steady_clock::now();
+        resample("NCC", bestPos, NCC, distribution, subresolution);
+        addStageDuration("resampling", start);
+      }
+    }
+
+    setCorrelationIncrement("MI", particleRowMI_.size());
+    if (MI_)
+    {
+      std::vector<float> MI; MI.clear();
+      map_min_ = data.minCoeffOfFinites();
+      map_max_ = data.maxCoeffOfFinites();
+      reference_min_ = reference_data.minCoeffOfFinites();
+      reference_max_ = reference_data.maxCoeffOfFinites();
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      iterateParticles("MI",subresolution,data,variance_data,reference_data,MI,correlationMap,shift);
+      addStageDuration("score_MI", start);
+
+      start = std::chrono::steady_clock::now();
+      std::vector<float> bestPos; bestPos.clear();
+      bestPos = findBestPos("MI", MI, subresolution);
+      addStageDuration("best_pos", start);
+
+      // Calculate z alignement
+      start = std::chrono::steady_clock::now();
+      float z = findZ(data, reference_data, bestPos[0], bestPos[1], bestPos[2]);
+      addStageDuration("z_alignment", start);
+      if (bestPos[3] != noneMI_) { cumErrorAndCorrMatches("MI", bestPos); }
+      addEstimate("MI", bestPos, z, shift, subresolution, estimates);
+      log_ << "Best MI " << bestPos[3] << " at " << bestPos[0] << ", " << bestPos[1] << " , theta " << bestPos[2] << " and z: " << z << "\n";
+      log_ << "Cumulative error MI: " << cumulativeErrorMI_ << " matches: " << correctMatchesMI_ << "\n";
+
+      if (resample_)
+      {
+        start = std::chrono::steady_clock::now();
+        resample("MI", bestPos, MI, distribution, subresolution);
+        addStageDuration("resampling", start);
+      }
+    }
+  }
+  else if (SAD_ && SSD_ && NCC_ && MI_) // just to speed up
+  {
+    std::vector<float> SAD; SAD.clear();
+    std::vector<float> SSD; SSD.clear();
+    std::vector<float> NCC; NCC.clear();
+    std::vector<float> MI; MI.clear();
+    map_min_ = data.minCoeffOfFinites();
+    map_max_ = data.maxCoeffOfFinites();
+    reference_min_ = reference_data.minCoeffOfFinites();
+    reference_max_ = reference_data.maxCoeffOfFinites();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+      TraceScope trace("iterateParticles all metrics");
+      startKernelCounters();
+      for (int i = 0; i < particleRowSAD_.size(); i++)
+      {
+        float row = float(particleRowSAD_[i])/subresolution;
+        float col = float(particleColSAD_[i])/subresolution;
+        grid_map::Index index = grid_map::Index(int(round(row)), int(round(col)));
+        int theta = particleThetaSAD_[i];
+
+        float sin_theta = sin((theta+templateRotation_)/180*M_PI);
+        float cos_theta = cos((theta+templateRotation_)/180*M_PI);
+
+        bool success = findMatches(data, variance_data, reference_data, row, col, sin_theta, cos_theta, true );
+
+        calculateSimilarity(success,"SAD",index,theta,SAD,correlationMap,shift);
+        calculateSimilarity(success,"SSD",index,theta,SSD,correlationMap,shift);
+        calculateSimilarity(success,"NCC",index,theta,NCC,correlationMap,shift);
+        calculateSimilarity(success,"MI",index,theta,MI,correlationMap,shift);
+      }
+      stopKernelCounters("score_all", particleRowSAD_.size());
+    }
+    addStageDuration("score_all", start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<float> bestPosSAD; bestPosSAD.clear();
+    bestPosSAD = findBestPos("SAD", SAD, subresolution);
+ 
+    std::vector<float> bestPosSSD; bestPosSSD.clear();
+    bestPosSSD = findBestPos("SSD", SSD, subresolution);
+
+    std::vector<float> bestPosNCC; bestPosNCC.clear();
+    bestPosNCC = findBestPos("NCC", NCC, subresolution);
+
+    std::vector<float> bestPosMI; bestPosMI.clear();
+    bestPosMI = findBestPos("MI", MI, subresolution);
+    addStageDuration("best_pos", start);
+
+    // Calculate z alignement
+    start = std::chrono::steady_clock::now();
+    float z = findZ(data, reference_data, bestPosSAD[0], bestPosSAD[1], bestPosSAD[2]);
+    addStageDuration("z_alignment", start);
+    if (bestPosSAD[3] != noneSAD_) { cumErrorAndCorrMatches("SAD", bestPosSAD); }
+    addEstimate("SAD", bestPosSAD, z, shift, subresolution, estimates);
+    log_ << "Best SAD " << bestPosSAD[3] << " at " << bestPosSAD[0] << ", " << bestPosSAD[1] << " , theta " << bestPosSAD[2] << " and z: " << z << "\n";
+    log_ << "Cumulative error SAD: " << cumulativeErrorSAD_ << " matches: " << correctMatchesSAD_ << "\n";
+
+    start = std::chrono::steady_clock::now();
+    z = findZ(data, reference_data, bestPosSSD[0], bestPosSSD[1], bestPosSSD[2]);
+    addStageDuration("z_alignment", start);
+    if (bestPosSSD[3] != noneSSD_) { cumErrorAndCorrMatches("SSD", bestPosSSD); }
+    addEstimate("SSD", bestPosSSD, z, shift, subresolution, estimates);
+    log_ << "Best SSD " << bestPosSSD[3] << " at " << bestPosSSD[0] << ", " << bestPosSSD[1] << " , theta " << bestPosSSD[2] << " and z: " << z << "\n";
+    log_ << "Cumulative error SSD: " << cumulativeErrorSSD_ << " matches: " << correctMatchesSSD_ << "\n";
+
+    start = std::chrono::steady_clock::now();
+    z = findZ(data, reference_data, bestPosNCC[0], bestPosNCC[1], bestPosNCC[2]);
+    addStageDuration("z_alignment", start);
+    if (bestPosNCC[3] != noneNCC_) { cumErrorAndCorrMatches("NCC", bestPosNCC); }
+    addEstimate("NCC", bestPosNCC, z, shift, subresolution, estimates);
+    log_ << "Best NCC " << bestPosNCC[3] << " at " << bestPosNCC[0] << ", " << bestPosNCC[1] << " , theta " << bestPosNCC[2] << " and z: " << z << "\n";
+    log_ << "Cumulative error NCC: " << cumulativeErrorNCC_ << " matches: " << correctMatchesNCC_ << "\n";
+
+    start = std::chrono::steady_clock::now();
+    z = findZ(data, reference_data, bestPosMI[0], bestPosMI[1], bestPosMI[2]);
+    addStageDuration("z_alignment", start);
+    if (bestPosMI[3] != noneMI_) { cumErrorAndCorrMatches("MI", bestPosMI); }
+    addEstimate("MI", bestPosMI, z, shift, subresolution, estimates);
+    log_ << "Best MI " << bestPosMI[3] << " at " << bestPosMI[0] << ", " << bestPosMI[1] << " , theta " << bestPosMI[2] << " and z: " << z << "\n";
+    log_ << "Cumulative error MI: " << cumulativeErrorMI_ << " matches: " << correctMatchesMI_ << "\n";
+
+    if (resample_)
+    {
+      start = std::chrono::steady_clock::now();
+      resample("SAD", bestPosSAD, SAD, distribution, subresolution);
+      resample("SSD", bestPosSSD, SSD, distribution, subresolution);
+      resample("NCC", bestPosNCC, NCC, distribution, subresolution);
+      resample("MI", bestPosMI, MI, distribution, subresolution);
+      addStageDuration("resampling", start);
+    }
+  }
+
+  if (computeCorrelationMap_) { correlationMap_ = std::make_shared<const grid_map::GridMap>(std::move(correlationMap)); }
+  else { correlationMap_.reset(); }
+
+  log_ << "Correct position " << map_position_.transpose() << " and theta " << (360-templateRotation_) << "\n";
+
+  addStageDuration("total", time);
+  log_ << "Time used:";
+  for (const auto& stage : stageDurations_) { log_ << " " << stage.first << ": " << stage.second; }
+  log_ << " [s]" << "\n";
+
+  // one record per match instead of a flushed line per printout
+  if (parameters_.verbose) { AsyncLogger::instance().log(LogLevel::Info, "match", logBuffer_.str()); }
+}
+
+const std::map<std::string, double>& MapFitterCore::getStageDurations() const
+{
+  return stageDurations_;
+}
+
+const std::map<std::string, KernelCounters>& MapFitterCore::getKernelCounters() const
+{
+  return kernelCounters_;
+}
+
+void MapFitterCore::startKernelCounters()
+{
+  if (!parameters_.perfCounters) { return; }
+  if (!perfCounters_)
+  {
+    perfCounters_.reset(new PerfCounters());
+    if (!perfCounters_->isAvailable()) { std::cerr << "Hardware performance counters are not available (" << perfCounters_->getError() << "), matching without them." << std::endl; }
+  }
+  if (perfCounters_->isAvailable()) { perfCounters_->start(); }
+}
+
+void MapFitterCore::stopKernelCounters(const std::string& stage, size_t numberOfParticles)
+{
+  if (!parameters_.perfCounters || !perfCounters_ || !perfCounters_->isAvailable()) { return; }
+  KernelCounters& counters = kernelCounters_[stage];
+  counters.counters += perfCounters_->stop();
+  // template cells visited by findMatches per particle
+  grid_map::Size size = map_.getSize();
+  double cellsPerParticle = double((size(0) - correlationIncrement_) / correlationIncrement_ + 1) * double((size(1) - correlationIncrement_) / correlationIncrement_ + 1);
+  counters.particles += numberOfParticles;
+  counters.cells += numberOfParticles * cellsPerParticle;
+}
+
+void MapFitterCore::setCorrelationIncrement(const std::string& score, size_t numberOfParticles)
+{
+  // a converged cloud is tracked with a sparser template sampling
+  if (tracking_[score]) { correlationIncrement_ = parameters_.trackingCorrelationIncrement; }
+  else if (numberOfParticles < 4000) { correlationIncrement_ = 1; }
+  else { correlationIncrement_ = 5; }
+}
+
+void MapFitterCore::updateTracking(const std::string& score, const std::vector<float>& bestPos, int subresolution)
+{
+  if (!parameters_.tracking) { return; }
+  bool lowerIsBetter = score == "SAD" || score == "SSD";
+  if (tracking_[score])
+  {
+    float reference = trackingScore_[score];
+    bool degraded = lowerIsBetter ? bestPos[3] > reference * (1.0 + parameters_.trackingScoreDrop) : bestPos[3] < reference * (1.0 - parameters_.trackingScoreDrop);
+    if (degraded)
+    {
+      tracking_[score] = false;
+      if (parameters_.verbose) { AsyncLogger::instance().log(LogLevel::Warning, "tracking " + score, "particle Filter " + score + " stopped tracking", parameters_.logInterval); }
+    }
+    return;
+  }
+
+  const std::vector<int>* rows;
+  const std::vector<int>* cols;
+  const std::vector<int>* thetas;
+  const std::vector<int>* counts;
+  if (score == "SAD") { rows = &particleRowSAD_; cols = &particleColSAD_; thetas = &particleThetaSAD_; counts = &particleCountSAD_; }
+  else if (score == "SSD") { rows = &particleRowSSD_; cols = &particleColSSD_; thetas = &particleThetaSSD_; counts = &particleCountSSD_; }
+  else if (score == "NCC") { rows = &particleRowNCC_; cols = &particleColNCC_; thetas = &particleThetaNCC_; counts = &particleCountNCC_; }
+  else { rows = &particleRowMI_; cols = &particleColMI_; thetas = &particleThetaMI_; counts = &particleCountMI_; }
+  if (rows->size() < 2) { return; }
+
+  // spread of the drawn particles in cells, theta relative to the best particle to handle the wrap around
+  Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+  Eigen::Vector3d secondMoment = Eigen::Vector3d::Zero();
+  double numberOfParticles = 0;
+  for (size_t i = 0; i < rows->size(); i++)
+  {
+    Eigen::Vector3d particle(float((*rows)[i])/subresolution, float((*cols)[i])/subresolution, fmod((*thetas)[i] - bestPos[2] + 540.0, 360.0) - 180.0);
+    mean += (*counts)[i] * particle;
+    secondMoment += (*counts)[i] * particle.cwiseProduct(particle);
+    numberOfParticles += (*counts)[i];
+  }
+  mean /= numberOfParticles;
+  Eigen::Vector3d variance = (secondMoment / numberOfParticles - mean.cwiseProduct(mean)).cwiseMax(0.0);
+  double positionSpread = sqrt(variance(0) + variance(1)) * referenceMap_.getResolution();
+  double angleSpread = sqrt(variance(2));
+  if (positionSpread < parameters_.trackingPositionSpread && angleSpread < parameters_.trackingAngleSpread)
+  {
+    tracking_[score] = true;
+    trackingScore_[score] = bestPos[3];
+    log_ << "particle Filter " << score << " tracking, spread " << positionSpread << " m, " << angleSpread << " deg" << "\n";
+  }
+}
+
+void MapFitterCore::addStageDuration(const std::string& stage, const std::chrono::steady_clock::time_point& start)
+{
+  stageDurations_[stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MapFitterCore::initializeParticles(int subresolution)
+{
+  TraceScope trace("initializeParticles");
+  // collect the search positions block-wise in parallel, keeping the iteration order
+  grid_map::ThreadPool& threadPool = grid_map::ThreadPool::getDefault();
+  std::vector<grid_map::BufferRegion> blocks;
+  grid_map::getRowBlocksForSubmap(blocks, searchStartIndex_, searchSize_, referenceMap_.getSize(), referenceMap_.getStartIndex(), threadPool.getNumberOfThreads(), searchIncrement_);
+  std::vector< std::vector<grid_map::Index> > blockIndices(blocks.size());
+  threadPool.parallelFor(blocks.size(), [&](size_t k)
+  {
+    for (grid_map::SubmapIteratorSparse iterator(referenceMap_, blocks[k], searchIncrement_); !iterator.isPastEnd(); ++iterator)
+    {
+      blockIndices[k].push_back(*iterator);
+    }
+  });
+  std::vector<grid_map::Index> indices;
+  for (auto& block : blockIndices) { indices.insert(indices.end(), block.begin(), block.end()); }
+
+  int numberOfParticles = 0;
+  for (float theta = 0; theta < 360; theta += angleIncrement_)
+  {
+    for (const grid_map::Index& index : indices)
+    {
+      if (initializeSAD_)
+      {
+        particleRowSAD_.push_back(index(0)*subresolution);
+        particleColSAD_.push_back(index(1)*subresolution);
+        particleThetaSAD_.push_back(theta);
+        particleCountSAD_.push_back(1);
+      }
+      if (initializeSSD_)
+      {
+        particleRowSSD_.push_back(index(0)*subresolution);
+        particleColSSD_.push_back(index(1)*subresolution);
+        particleThetaSSD_.push_back(theta);
+        particleCountSSD_.push_back(1);
+      }
+      if (initializeNCC_)
+      {
+        particleRowNCC_.push_back(index(0)*subresolution);
+        particleColNCC_.push_back(index(1)*subresolution);
+        particleThetaNCC_.push_back(theta);
+        particleCountNCC_.push_back(1);
+      }
+      if (initializeMI_)
+      {
+        particleRowMI_.push_back(index(0)*subresolution);
+        particleColMI_.push_back(index(1)*subresolution);
+        particleThetaMI_.push_back(theta);
+        particleCountMI_.push_back(1);
+      }
+      numberOfParticles += 1;
+    }
+  }
+  //templateRotation_ = static_cast <float> (rand() / static_cast <float> (RAND_MAX/360)); //rand() %360;
+  if (initializeSAD_) { log_ <<"Number of particles SAD: " << numberOfParticles << "\n"; }
+  if (initializeSSD_) { log_ <<"Number of particles SSD: " << numberOfParticles << "\n"; }
+  if (initializeNCC_) { log_ <<"Number of particles NCC: " << numberOfParticles << "\n"; }
+  if (initializeMI_) { log_ <<"Number of particles MI: " << numberOfParticles << "\n"; }
+
+  initializeSAD_ = false;
+  initializeSSD_ = false;
+  initializeNCC_ = false;
+  initializeMI_ = false;
+}
+
+bool MapFitterCore::initializeLocalParticles(const std::string& score, int subresolution)
+{
+  TraceScope trace("initializeLocalParticles");
+  grid_map::Size reference_size = referenceMap_.getSize();
+  int rows = reference_size(0)*subresolution;
+  int cols = reference_size(1)*subresolution;
+
+  // the pose of the prior and the last good estimate moved along with it
+  std::vector< std::vector<int> > centers;
+  grid_map::Index priorIndex;
+  if (referenceMap_.getIndex(map_position_, priorIndex))
+  {
+    std::vector<int> prior = {priorIndex(0)*subresolution, priorIndex(1)*subresolution, int(round(360 - templateRotation_)) % 360};
+    centers.push_back(prior);
+    if (recoveryOffset_.count(score))
+    {
+      const std::vector<int>& offset = recoveryOffset_[score];
+      centers.push_back({prior[0] + offset[0], prior[1] + offset[1], prior[2] + offset[2]});
+    }
+  }
+
+  const int window = int(parameters_.recoveryWindow / referenceMap_.getResolution()) * subresolution;
+  const int angleWindow = int(parameters_.recoveryAngleWindow);
+  int step = std::max(1, searchIncrement_) * subresolution;
+  int angleStep = std::max(1, angleIncrement_);
+  // the grid is coarsened in its denser dimension until it fits the particle budget
+  while (true)
+  {
+    const int positions = 2 * (window / step) + 1;
+    const int angles = 2 * (angleWindow / angleStep) + 1;
+    if (int(centers.size()) * positions * positions * angles <= numberOfParticles_) { break; }
+    if (positions * positions >= angles && step <= window) { step *= 2; }
+    else if (angleStep <= angleWindow) { angleStep *= 2; }
+    else { break; }
+  }
+
+  std::vector< std::array<int,3> > particles;
+  for (const std::vector<int>& center : centers)
+  {
+    for (int row = -(window / step) * step; row <= window; row += step)
+    {
+      for (int col = -(window / step) * step; col <= window; col += step)
+      {
+        for (int theta = -(angleWindow / angleStep) * angleStep; theta <= angleWindow; theta += angleStep)
+        {
+          particles.push_back({{((center[0] + row) % rows + rows) % rows, ((center[1] + col) % cols + cols) % cols, ((center[2] + theta) % 360 + 360) % 360}});
+        }
+      }
+    }
+  }
+  // the windows of the two centers can overlap
+  std::sort(particles.begin(), particles.end());
+  particles.erase(std::unique(particles.begin(), particles.end()), particles.end());
+
+  std::vector<int>* particleRow;
+  std::vector<int>* particleCol;
+  std::vector<int>* particleTheta;
+  std::vector<int>* particleCount;
+  if (score == "SAD") { particleRow = &particleRowSAD_; particleCol = &particleColSAD_; particleTheta = &particleThetaSAD_; particleCount = &particleCountSAD_; }
+  else if (score == "SSD") { particleRow = &particleRowSSD_; particleCol = &particleColSSD_; particleTheta = &particleThetaSSD_; particleCount = &particleCountSSD_; }
+  else if (score == "NCC") { particleRow = &particleRowNCC_; particleCol = &particleColNCC_; particleTheta = &particleThetaNCC_; particleCount = &particleCountNCC_; }
+  else { particleRow = &particleRowMI_; particleCol = &particleColMI_; particleTheta = &particleThetaMI_; particleCount = &particleCountMI_; }
+  for (const std::array<int,3>& particle : particles)
+  {
+    particleRow->push_back(particle[0]);
+    particleCol->push_back(particle[1]);
+    particleTheta->push_back(particle[2]);
+    particleCount->push_back(1);
+  }
+  log_ << "Number of particles " << score << ": " << particles.size() << " (local)\n";
+  return !particles.empty();
+}
+
+void MapFitterCore::clearParticles(const std::string& score)
+{
+  if (score == "SAD") { particleRowSAD_.clear(); particleColSAD_.clear(); particleThetaSAD_.clear(); particleCountSAD_.clear(); }
+  if (score == "SSD") { particleRowSSD_.clear(); particleColSSD_.clear(); particleThetaSSD_.clear(); particleCountSSD_.clear(); }
+  if (score == "NCC") { particleRowNCC_.clear(); particleColNCC_.clear(); particleThetaNCC_.clear(); particleCountNCC_.clear(); }
+  if (score == "MI") { particleRowMI_.clear(); particleColMI_.clear(); particleThetaMI_.clear(); particleCountMI_.clear(); }
+}
+
+bool MapFitterCore::setCorrelationMapGeometry(grid_map::GridMap& correlationMap, const grid_map::Position& shift, int subresolution)
+{
+  std::vector<const std::vector<int>*> rows;
+  std::vector<const std::vector<int>*> cols;
+  if (SAD_) { rows.push_back(&particleRowSAD_); cols.push_back(&particleColSAD_); }
+  if (SSD_) { rows.push_back(&particleRowSSD_); cols.push_back(&particleColSSD_); }
+  if (NCC_) { rows.push_back(&particleRowNCC_); cols.push_back(&particleColNCC_); }
+  if (MI_) { rows.push_back(&particleRowMI_); cols.push_back(&particleColMI_); }
+
+  // bounding box of the cell centers of all particles
+  grid_map::Position min(std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+  grid_map::Position max = -min;
+  for (size_t k = 0; k < rows.size(); k++)
+  {
+    for (size_t i = 0; i < rows[k]->size(); i++)
+    {
+      grid_map::Index index(int(round(float((*rows[k])[i])/subresolution)), int(round(float((*cols[k])[i])/subresolution)));
+      grid_map::Position xy_position;
+      if (!referenceMap_.getPosition(index, xy_position)) { continue; }
+      min = min.cwiseMin(xy_position);
+      max = max.cwiseMax(xy_position);
+    }
+  }
+  if ((min.array() > max.array()).any()) { return false; }
+
+  double resolution = referenceMap_.getResolution();
+  correlationMap.setGeometry(grid_map::Length(max - min) + grid_map::Length::Constant(resolution), resolution, (min + max) / 2.0 - shift);
+  return true;
+}
+
+void MapFitterCore::iterateParticles(std::string score,int subresolution,const ConstMatrixMap& data,const ConstMatrixMap& variance_data,const grid_map::LayerView& reference_data,std::vector<float>& scores,grid_map::GridMap& correlationMap,grid_map::Position& shift)
+{
+  TraceScope trace(score == "SAD" ? "iterateParticles SAD" : score == "SSD" ? "iterateParticles SSD" : score == "NCC" ? "iterateParticles NCC" : "iterateParticles MI");
+  std::map <std::string,std::vector<int>> rowMap;
+  rowMap["SAD"] = particleRowSAD_; rowMap["SSD"] = particleRowSSD_; rowMap["NCC"] = particleRowNCC_; rowMap["MI"] = particleRowMI_;
+  std::map <std::string,std::vector<int>> colMap;
+  colMap["SAD"] = particleColSAD_; colMap["SSD"] = particleColSSD_; colMap["NCC"] = particleColNCC_; colMap["MI"] = particleColMI_;
+  std::map <std::string,std::vector<int>> thetaMap;
+  thetaMap["SAD"] = particleThetaSAD_; thetaMap["SSD"] = particleThetaSSD_; thetaMap["NCC"] = particleThetaNCC_; thetaMap["MI"] = particleThetaMI_;
+
+  startKernelCounters();
+  for (int i = 0; i < rowMap[score].size(); i++)
+  {
+    float row = float(rowMap[score][i])/subresolution;
+    float col = float(colMap[score][i])/subresolution;
+    grid_map::Index index = grid_map::Index(int(round(row)), int(round(col)));
+    int theta = thetaMap[score][i];
+
+    float sin_theta = sin((theta+templateRotation_)/180*M_PI);
+    float cos_theta = cos((theta+templateRotation_)/180*M_PI);
+
+    bool success;
+    if (score=="MI") { success = findMatches(data, variance_data, reference_data, row, col, sin_theta, cos_theta, true ); }
+    else { success = findMatches(data, variance_data, reference_data, row, col, sin_theta, cos_theta, false ); }
+    
+    calculateSimilarity(success,score,index,theta,scores,correlationMap,shift);
+  }
+  stopKernelCounters("score_" + score, rowMap[score].size());
+}
+
+void MapFitterCore::calculateSimilarity(bool success,std::string score,grid_map::Index index,int theta,std::vector<float>& scores,grid_map::GridMap& correlationMap,grid_map::Position& shift)
+{
+  if (success) 
+    {
+      float value;
+      if (!weighted_) 
+      { 
+        if(score=="SAD") {value = errorSAD();}
+        if(score=="SSD") {value = errorSSD();}
+        if(score=="NCC") {value = correlationNCC();}
+        if(score=="MI") {value = mutualInformation();}
+      }
+      else 
+      { 
+        if(score=="SAD") {value = weightedErrorSAD();}
+        if(score=="SSD") {value = weightedErrorSSD();}
+        if(score=="NCC") {value = weightedCorrelationNCC();}
+        if(score=="MI") {value = normalizedMutualInformation();}
+      }
+
+      scores.push_back(value);
+
+      grid_map::Position xy_position;
+      if (!computeCorrelationMap_) { return; }
+      referenceMap_.getPosition(index, xy_position);
+      if (correlationMap.isInside(xy_position-shift))
+      {
+        grid_map::Index correlation_index;
+        correlationMap.getIndex(xy_position-shift, correlation_index);
+
+        bool valid = correlationMap.isValid(correlation_index, score);
+        // if no value so far or correlation smaller or correlation higher than for other thetas
+        if (((valid == false) || (value < correlationMap.at(score, correlation_index) ))) 
+        {
+          float alpha = 1;
+          if(score=="SAD") {alpha = 10;}
+          if(score=="SSD") {alpha = 50;}
+          correlationMap.at(score, correlation_index) = alpha*value;  //set correlation
+          correlationMap.at("rotation"+score, correlation_index) = theta;    //set theta
+        }
+      }
+    }
+    else 
+    { 
+      if(score=="SAD") {scores.push_back(noneSAD_);}
+      if(score=="SSD") {scores.push_back(noneSSD_);}
+      if(score=="NCC") {scores.push_back(noneNCC_);}
+      if(score=="MI") {scores.push_back(noneMI_);}
+    }
+}
+
+std::vector<float> MapFitterCore::findBestPos(std::string score, std::vector<float> scores, int subresolution)
+{
+  // without particles there is no best one, the center of the reference map keeps findZ inside of it
+  if (scores.empty())
+  {
+    std::map <std::string, int> noneMap;
+    noneMap["SAD"] = noneSAD_; noneMap["SSD"] = noneSSD_; noneMap["NCC"] = noneNCC_; noneMap["MI"] = noneMI_;
+    const grid_map::Position center = referenceMap_.getPosition();
+    return {float(center(0)), float(center(1)), 0.0f, float(noneMap[score])};
+  }
+
+  std::map <std::string,std::vector<int>> rowMap;
+  rowMap["SAD"] = particleRowSAD_; rowMap["SSD"] = particleRowSSD_; rowMap["NCC"] = particleRowNCC_; rowMap["MI"] = particleRowMI_;
+  std::map <std::string,std::vector<int>> colMap;
+  colMap["SAD"] = particleColSAD_; colMap["SSD"] = particleColSSD_; colMap["NCC"] = particleColNCC_; colMap["MI"] = particleColMI_;
+  std::map <std::string,std::vector<int>> thetaMap;
+  thetaMap["SAD"] = particleThetaSAD_; thetaMap["SSD"] = particleThetaSSD_; thetaMap["NCC"] = particleThetaNCC_; thetaMap["MI"] = particleThetaMI_;
+
+  grid_map::Size reference_size = referenceMap_.getSize();
+  int rows = reference_size(0);
+  int cols = reference_size(1);
+  grid_map::Position best_pos;
+
+  int bestParticle;
+  if (score == "SAD" || score == "SSD")
+  {
+    std::vector<float>::iterator it = std::min_element(scores.begin(), scores.end());
+    bestParticle = std::distance(scores.begin(), it);
+  }
+  else
+  {
+    std::vector<float>::iterator it = std::max_element(scores.begin(), scores.end());
+    bestParticle = std::distance(scores.begin(), it);
+  }
+
+  float value = scores[bestParticle];
+  int bestRow = int(round(float(rowMap[score][bestParticle])/subresolution)) % rows;
+  int bestCol = int(round(float(colMap[score][bestParticle])/subresolution)) % cols;
+  referenceMap_.getPosition(grid_map::Index(bestRow, bestCol), best_pos);
+  float bestX = best_pos(0) - ( float(rowMap[score][bestParticle])/subresolution-int(round(float(rowMap[score][bestParticle])/subresolution)) )*referenceMap_.getResolution(); 
+  float bestY = best_pos(1) - ( float(colMap[score][bestParticle])/subresolution-int(round(float(colMap[score][bestParticle])/subresolution)) )*referenceMap_.getResolution();
+  int bestTheta = thetaMap[score][bestParticle];
+
+  std::vector<float> bestPos;
+  bestPos.clear();
+  bestPos.push_back(bestX);
+  bestPos.push_back(bestY);
+  bestPos.push_back(bestTheta);
+  bestPos.push_back(value);
+  return bestPos;
+}
+
+void MapFitterCore::addEstimate(std::string score, std::vector<float>& bestPos, float z, grid_map::Position& shift, int subresolution, std::vector<MatchEstimate>& estimates)
+{
+  const std::vector<int>* rows;
+  const std::vector<int>* cols;
+  const std::vector<int>* thetas;
+  const std::vector<int>* counts;
+  float none;
+  if (score == "SAD") { rows = &particleRowSAD_; cols = &particleColSAD_; thetas = &particleThetaSAD_; counts = &particleCountSAD_; none = noneSAD_; }
+  else if (score == "SSD") { rows = &particleRowSSD_; cols = &particleColSSD_; thetas = &particleThetaSSD_; counts = &particleCountSSD_; none = noneSSD_; }
+  else if (score == "NCC") { rows = &particleRowNCC_; cols = &particleColNCC_; thetas = &particleThetaNCC_; counts = &particleCountNCC_; none = noneNCC_; }
+  else { rows = &particleRowMI_; cols = &particleColMI_; thetas = &particleThetaMI_; counts = &particleCountMI_; none = noneMI_; }
+
+  MatchEstimate estimate;
+  estimate.metric = score;
+  estimate.valid = bestPos[3] != none;
+  estimate.x = bestPos[0] - shift(0);
+  estimate.y = bestPos[1] - shift(1);
+  estimate.theta = bestPos[2];
+  estimate.z = z;
+  estimate.score = bestPos[3];
+
+  // covariance of the particle cloud (with the multiplicity of the states), theta relative to the best particle to handle the wrap around
+  Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+  Eigen::Matrix3d secondMoment = Eigen::Matrix3d::Zero();
+  int numberOfParticles = 0;
+  for (size_t i = 0; i < rows->size(); i++)
+  {
+    grid_map::Index index(int(round(float((*rows)[i])/subresolution)), int(round(float((*cols)[i])/subresolution)));
+    grid_map::Position xy_position;
+    if (!referenceMap_.getPosition(index, xy_position)) { continue; }
+    Eigen::Vector3d particle(xy_position(0), xy_position(1), fmod((*thetas)[i] - bestPos[2] + 540.0, 360.0) - 180.0);
+    mean += (*counts)[i] * particle;
+    secondMoment += (*counts)[i] * particle * particle.transpose();
+    numberOfParticles += (*counts)[i];
+  }
+  Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+  if (numberOfParticles > 1)
+  {
+    mean /= numberOfParticles;
+    covariance = secondMoment / numberOfParticles - mean * mean.transpose();
+  }
+  estimate.covariance = covariance;
+
+  estimates.push_back(estimate);
+}
+
+void MapFitterCore::cumErrorAndCorrMatches(std::string score, std::vector<float> bestPos)
+{
+  float distError = sqrt((bestPos[0] - map_position_(0))*(bestPos[0] - map_position_(0)) + (bestPos[1] - map_position_(1))*(bestPos[1] - map_position_(1)) );
+  if (score == "SAD") { cumulativeErrorSAD_ += distError; }
+  if (score == "SSD") { cumulativeErrorSSD_ += distError; }
+  if (score == "NCC") { cumulativeErrorNCC_ += distError; }
+  if (score == "MI") { cumulativeErrorMI_ += distError; }
+
+  if (distError < 0.5 && (fabs(bestPos[2] - (360-templateRotation_)) < angleIncrement_ || fabs(bestPos[2] - (360-templateRotation_)) > 360-angleIncrement_)) 
+  {
+    if (score == "SAD") { correctMatchesSAD_ += 1; }
+    if (score == "SSD") { correctMatchesSSD_ += 1; }
+    if (score == "NCC") { correctMatchesNCC_ += 1; }
+    if (score == "MI") { correctMatchesMI_ += 1; }
+  }
+}
+
+int MapFitterCore::kldNumberOfParticles(size_t numberOfBins, double epsilon, double quantile)
+{
+  if (numberOfBins < 2) { return 1; }
+  // Wilson-Hilferty approximation of the chi-square quantile with k-1 degrees of freedom
+  double k = numberOfBins - 1;
+  double a = 2.0 / (9.0 * k);
+  double b = 1.0 - a + sqrt(a) * quantile;
+  return int(ceil(k / (2.0 * epsilon) * b * b * b));
+}
+
+void MapFitterCore::resample(std::string score, std::vector<float> bestPos, std::vector<float> scores, std::normal_distribution<float>& distribution, int subresolution)
+{
+  TraceScope trace("resample");
+  std::vector<int>* particleRows;
+  std::vector<int>* particleCols;
+  std::vector<int>* particleThetas;
+  std::vector<int>* particleCounts;
+  if (score == "SAD") { particleRows = &particleRowSAD_; particleCols = &particleColSAD_; particleThetas = &particleThetaSAD_; particleCounts = &particleCountSAD_; }
+  else if (score == "SSD") { particleRows = &particleRowSSD_; particleCols = &particleColSSD_; particleThetas = &particleThetaSSD_; particleCounts = &particleCountSSD_; }
+  else if (score == "NCC") { particleRows = &particleRowNCC_; particleCols = &particleColNCC_; particleThetas = &particleThetaNCC_; particleCounts = &particleCountNCC_; }
+  else { particleRows = &particleRowMI_; particleCols = &particleColMI_; particleThetas = &particleThetaMI_; particleCounts = &particleCountMI_; }
+  std::map <std::string, float> thresMap;
+  thresMap["SAD"] = SADThreshold_; thresMap["SSD"] = SSDThreshold_; thresMap["NCC"] = NCCThreshold_; thresMap["MI"] = MIThreshold_;
+  std::map <std::string, int> noneMap;
+  noneMap["SAD"] = noneSAD_; noneMap["SSD"] = noneSSD_; noneMap["NCC"] = noneNCC_; noneMap["MI"] = noneMI_;
+  std::map <std::string, float> rhoMap;
+  rhoMap["SAD"] = rhoSAD_; rhoMap["SSD"] = rhoSSD_; rhoMap["NCC"] = rhoNCC_; rhoMap["MI"] = rhoMI_;
+
+  grid_map::Size reference_size = referenceMap_.getSize();
+  int rows = reference_size(0);
+  int cols = reference_size(1);
+
+  // a metric without particles, e.g. after an empty search region, searches the whole map again
+  const bool noParticles = particleRows->empty();
+
+  std::vector<float> beta;
+  beta.clear();
+  for (int i = 0; i < particleRows->size(); i++)
+  {
+      // a state drawn several times keeps the weight of all its particles
+      beta.push_back((*particleCounts)[i] * exp(scores[i]/rhoMap[score]));
+  }
+  float sum = std::accumulate(beta.begin(), beta.end(), 0.0);
+  if ( noParticles || ( ( ((score == "SAD" || score == "SSD") && (sum == 0.0 || bestPos[3] > thresMap[score])) || ((score == "NCC" || score == "MI") && (sum == 0.0 || bestPos[3] < thresMap[score])) ) && bestPos[3] != noneMap[score] ) )                           // fix for second dataset with empty template update
+  {
+    TraceScope reinitTrace("reinit");
+    clearParticles(score);
+    tracking_[score] = false;
+    // search around the last good estimate first, the whole map if that failed too or the prior is outside of the reference map
+    if (!noParticles && parameters_.localReinitialization && recoveryTier_[score] == 0 && initializeLocalParticles(score, subresolution))
+    {
+      recoveryTier_[score] = 1;
+      if (parameters_.verbose) { AsyncLogger::instance().log(LogLevel::Warning, "reinit " + score, "particle Filter " + score + " reinitialized locally", parameters_.logInterval); }
+    }
+    else
+    {
+      if (score == "SAD") { initializeSAD_ = true; }
+      if (score == "SSD") { initializeSSD_ = true; }
+      if (score == "NCC") { initializeNCC_ = true; }
+      if (score == "MI") { initializeMI_ = true; }
+      recoveryTier_[score] = 2;
+      if (parameters_.verbose) { AsyncLogger::instance().log(LogLevel::Warning, "reinit " + score, "particle Filter " + score + " reinitialized globally", parameters_.logInterval); }
+    }
+  }
+  else if(bestPos[3] != noneMap[score])
+  {
+    // remember where the filter was relative to the prior for a later local reinitialization
+    grid_map::Index goodIndex, priorIndex;
+    if (referenceMap_.getIndex(grid_map::Position(bestPos[0], bestPos[1]), goodIndex) && referenceMap_.getIndex(map_position_, priorIndex))
+    {
+      std::vector<int> period = {rows*subresolution, cols*subresolution, 360};
+      std::vector<int> difference = {(goodIndex(0) - priorIndex(0))*subresolution, (goodIndex(1) - priorIndex(1))*subresolution, int(round(bestPos[2] - (360 - templateRotation_)))};
+      for (int k = 0; k < 3; k++) { difference[k] = ((difference[k] % period[k]) + period[k] + period[k]/2) % period[k] - period[k]/2; }
+      recoveryOffset_[score] = difference;
+    }
+    recoveryTier_[score] = 0;
+
+    std::transform(beta.begin(), beta.end(), beta.begin(), std::bind1st(std::multiplies<float>(), 1.0/sum));
+    std::partial_sum(beta.begin(), beta.end(), beta.begin());
+
+    std::vector< std::vector<int> > newParticles;
+    newParticles.clear();
+
+    // KLD-sampling: draw until the number of particles bounds the error of the posterior in the occupied bins
+    int maximumDraws = tracking_[score] ? parameters_.trackingParticles : numberOfParticles_;
+    int requiredDraws = parameters_.adaptiveParticles ? std::min(parameters_.minimumNumberOfParticles, maximumDraws) : maximumDraws;
+    const double binSize = std::max(1.0, parameters_.kldBinSize / referenceMap_.getResolution() * subresolution);
+    const double angleBinSize = std::max(1.0, parameters_.kldAngleBinSize);
+    std::set< std::vector<int> > occupiedBins;
+    // drawn from the generator of this instance, such that matchers in other threads do not change the result
+    std::uniform_real_distribution<float> uniform(beta[0], beta.back());
+    for (int i = 0; i < maximumDraws && i < requiredDraws; i++)
+    {
+      float randNumber = uniform(generator_);
+      int ind = std::upper_bound(beta.begin(), beta.end(), randNumber) - beta.begin() -1;
+
+      std::vector<int> particle;
+      particle.clear();
+
+      particle.push_back( int((*particleRows)[ind] + round(distribution(generator_)) + rows*subresolution) % (rows*subresolution) );
+      particle.push_back( int((*particleCols)[ind] + round(distribution(generator_)) + cols*subresolution) % (cols*subresolution) );
+      particle.push_back( int((*particleThetas)[ind] + round(distribution(generator_)) + 360) % 360);
+      newParticles.push_back(particle);
+
+      if (parameters_.adaptiveParticles && occupiedBins.insert({int(particle[0] / binSize), int(particle[1] / binSize), int(particle[2] / angleBinSize)}).second)
+      {
+        requiredDraws = std::max(requiredDraws, kldNumberOfParticles(occupiedBins.size(), parameters_.kldEpsilon, parameters_.kldQuantile));
+      }
+    }
+    
+    std::sort(newParticles.begin(), newParticles.end());
+
+    // when tracking, only a window around the best particle is searched
+    grid_map::Index bestIndex;
+    if (tracking_[score] && referenceMap_.getIndex(grid_map::Position(bestPos[0], bestPos[1]), bestIndex))
+    {
+      const int window = std::max(1, int(round(parameters_.trackingWindow / referenceMap_.getResolution() * subresolution)));
+      std::vector<int> best = {bestIndex(0)*subresolution, bestIndex(1)*subresolution, int(round(bestPos[2]))};
+      std::vector<int> period = {rows*subresolution, cols*subresolution, 360};
+      auto outside = [&](const std::vector<int>& particle)
+      {
+        for (int k = 0; k < 3; k++)
+        {
+          int difference = ((particle[k] - best[k]) % period[k] + period[k] + period[k]/2) % period[k] - period[k]/2;
+          if (std::abs(difference) > (k < 2 ? window : parameters_.trackingAngleWindow)) { return true; }
+        }
+        return false;
+      };
+      auto end = std::remove_if(newParticles.begin(), newParticles.end(), outside);
+      if (end != newParticles.begin()) { newParticles.erase(end, newParticles.end()); }
+    }
+
+    // identical particles are kept once with their number
+    int numberOfDraws = newParticles.size();
+    std::vector< std::vector<int> > uniqueParticles;
+    std::vector<int> counts;
+    for (const std::vector<int>& particle : newParticles)
+    {
+      if (!uniqueParticles.empty() && uniqueParticles.back() == particle) { counts.back() += 1; }
+      else
+      {
+        uniqueParticles.push_back(particle);
+        counts.push_back(1);
+      }
+    }
+    newParticles.swap(uniqueParticles);
+
+    int numberOfParticles = newParticles.size();
+    particleRows->clear(); particleCols->clear(); particleThetas->clear();
+    for (int i = 0; i < numberOfParticles; i++)
+    {
+      particleRows->push_back(newParticles[i][0]);
+      particleCols->push_back(newParticles[i][1]);
+      particleThetas->push_back(newParticles[i][2]);
+    }
+    particleCounts->swap(counts);
+    log_ <<"New number of particles " << score << ": " << numberOfParticles << " of " << numberOfDraws << " drawn" << (tracking_[score] ? " (tracking)" : "") << "\n";
+    updateTracking(score, bestPos, subresolution);
+  }
+}
+
+float MapFitterCore::findZ(const ConstMatrixMap& data, const grid_map::LayerView& reference_data, float x, float y, int theta)
+{
+  grid_map::Index reference_index;
+  referenceMap_.getIndex(grid_map::Position(x,y), reference_index);
+  float sin_theta = sin((theta+templateRotation_)/180*M_PI);
+  float cos_theta = cos((theta+templateRotation_)/180*M_PI);
+
+  // initialize
+  float shifted_mean = 0;
+  float reference_mean = 0;
+  int matches = 0;
+
+  Eigen::Array2i size = map_.getSize();
+  int size_x = size(0);
+  int size_y = size(1);
+  Eigen::Array2i start_index = map_.getStartIndex();
+  int start_index_x = start_index(0);
+  int start_index_y = start_index(1);
+  Eigen::Array2i reference_size = referenceMap_.getSize();
+  int reference_size_x = reference_size(0);
+  int reference_size_y = reference_size(1);
+  Eigen::Array2i reference_start_index = referenceMap_.getStartIndex();
+  int reference_start_index_x = reference_start_index(0);
+  int reference_start_index_y = reference_start_index(1);
+  int reference_index_x = reference_index(0);
+  int reference_index_y = reference_index(1);
+
+  for (int i = 0; i < size_x; i ++)
+  {
+    for (int j = 0; j< size_y; j ++)
+    {
+      int index_x = (start_index_x + i) % size_x;
+      int index_y = (start_index_y + j) % size_y;
+
+      float mapHeight = data(index_x, index_y);
+      if (mapHeight == mapHeight)
+      {
+        int reference_buffer_index_x = reference_size_x - reference_start_index_x + reference_index_x;
+        int reference_buffer_index_y = reference_size_y - reference_start_index_y + reference_index_y;
+
+        int shifted_index_x = reference_buffer_index_x % reference_size_x - round(cos_theta*(float(size_x)/2-i) - sin_theta*(float(size_y)/2-j));
+        int shifted_index_y = reference_buffer_index_y % reference_size_y - round(sin_theta*(float(size_x)/2-i) + cos_theta*(float(size_y)/2-j));
+              
+        if (shifted_index_x >= 0 && shifted_index_x < reference_size_x && shifted_index_y >= 0 && shifted_index_y < reference_size_y )
+        {
+          shifted_index_x = (shifted_index_x + reference_start_index_x) % reference_size_x;
+          shifted_index_y = (shifted_index_y + reference_start_index_y) % reference_size_y;
+          float referenceHeight = reference_data(shifted_index_x, shifted_index_y);
+          if (referenceHeight == referenceHeight)
+          {
+            matches += 1;
+            shifted_mean += mapHeight;
+            reference_mean += referenceHeight;
+          }
+        }
+      }
+    }
+  }
+  // calculate mean
+  shifted_mean = shifted_mean/matches;
+  reference_mean = reference_mean/matches;
+
+  return reference_mean - shifted_mean;
+}
+
+bool MapFitterCore::findMatches(const ConstMatrixMap& data, const ConstMatrixMap& variance_data, const grid_map::LayerView& reference_data, float row, float col, float sin_theta, float cos_theta, bool equal)
+{
+  // initialize
+  int points = 0;
+  matches_ = 0;
+
+  shifted_mean_ = 0;
+  reference_mean_ = 0;
+  xy_shifted_.clear();
+  xy_reference_.clear();
+  xy_shifted_var_.clear();
+
+  Eigen::Array2i size = map_.getSize();
+  int size_x = size(0);
+  int size_y = size(1);
+  Eigen::Array2i start_index = map_.getStartIndex();
+  int start_index_x = start_index(0);
+  int start_index_y = start_index(1);
+  Eigen::Array2i reference_size = referenceMap_.getSize();
+  int reference_size_x = reference_size(0);
+  int reference_size_y = reference_size(1);
+  Eigen::Array2i reference_start_index = referenceMap_.getStartIndex();
+  int reference_start_index_x = reference_start_index(0);
+  int reference_start_index_y = reference_start_index(1);
+  float reference_index_x = row; //reference_index(0);
+  float reference_index_y = col; //reference_index(1);
+
+  for (int i = 0; i <= size_x-correlationIncrement_; i += correlationIncrement_)
+  {
+    for (int j = 0; j<= size_y-correlationIncrement_; j += correlationIncrement_)
+    {
+      int index_x = (start_index_x + i) % size_x;
+      int index_y = (start_index_y + j) % size_y;
+
+      float mapHeight = data(index_x, index_y);
+      if (mapHeight == mapHeight)
+      {
+        points += 1;
+        float reference_buffer_index_x = reference_size_x - reference_start_index_x + reference_index_x;
+        float reference_buffer_index_y = reference_size_y - reference_start_index_y + reference_index_y;
+
+        int shifted_index_x = round(fmod(reference_buffer_index_x, reference_size_x) - (cos_theta*(float(size_x)/2-i) - sin_theta*(float(size_y)/2-j)) );
+        int shifted_index_y = round(fmod(reference_buffer_index_y, reference_size_y) - (sin_theta*(float(size_x)/2-i) + cos_theta*(float(size_y)/2-j)) );
+              
+        if (shifted_index_x >= 0 && shifted_index_x < reference_size_x && shifted_index_y >= 0 && shifted_index_y < reference_size_y )
+        {
+          shifted_index_x = (shifted_index_x + reference_start_index_x) % reference_size_x;
+          shifted_index_y = (shifted_index_y + reference_start_index_y) % reference_size_y;
+          float referenceHeight = reference_data(shifted_index_x, shifted_index_y);
+          if (referenceHeight == referenceHeight)
+          {
+            matches_ += 1;
+            shifted_mean_ += mapHeight;
+            reference_mean_ += referenceHeight;
+            xy_shifted_.push_back(mapHeight);
+            xy_reference_.push_back(referenceHeight);
+            float mapVariance = variance_data(index_x, index_y);
+            if (mapVariance < 1e-6) { mapVariance = 1e-6; }
+            xy_shifted_var_.push_back(mapVariance);
+          }
+        }
+      }
+    }
+  }
+  // check if required overlap is fulfilled
+  if (matches_ > points*requiredOverlap_) 
+  { 
+    if (equal)
+    {
+      //assure that we always have the same number of points
+      std::uniform_int_distribution<int> uniform_x(0, size_x-1);
+      std::uniform_int_distribution<int> uniform_y(0, size_y-1);
+      for (int f =0; f < size_x*size_y; f++)
+      {
+        int index_x = uniform_x(generator_);
+        int index_y = uniform_y(generator_);
+        int i = (index_x - start_index_x + size_x) % size_x; 
+        int j = (index_y - start_index_y + size_y) % size_y; 
+        float mapHeight = data(index_x, index_y);
+        if (mapHeight == mapHeight)
+        {
+          float reference_buffer_index_x = reference_size_x - reference_start_index_x + reference_index_x;
+          float reference_buffer_index_y = reference_size_y - reference_start_index_y + reference_index_y;
+
+          int shifted_index_x = round(fmod(reference_buffer_index_x, reference_size_x) - (cos_theta*(float(size_x)/2-i) - sin_theta*(float(size_y)/2-j)) );
+          int shifted_index_y = round(fmod(reference_buffer_index_y, reference_size_y) - (sin_theta*(float(size_x)/2-i) + cos_theta*(float(size_y)/2-j)) );
+                
+          if (shifted_index_x >= 0 && shifted_index_x < reference_size_x && shifted_index_y >= 0 && shifted_index_y < reference_size_y )
+          {
+            shifted_index_x = (shifted_index_x + reference_start_index_x) % reference_size_x;
+            shifted_index_y = (shifted_index_y + reference_start_index_y) % reference_size_y;
+            float referenceHeight = reference_data(shifted_index_x, shifted_index_y);
+            if (referenceHeight == referenceHeight)
+            {
+              matches_ += 1;
+              shifted_mean_ += mapHeight;
+              reference_mean_ += referenceHeight;
+              xy_shifted_.push_back(mapHeight);
+              xy_reference_.push_back(referenceHeight);
+              float mapVariance = variance_data(index_x, index_y);
+              if (mapVariance < 1e-6) { mapVariance = 1e-6; }
+              xy_shifted_var_.push_back(mapVariance);
+            }
+          }
+        }
+        if (matches_ == points)
+        {
+          shifted_mean_ = shifted_mean_/matches_;
+          reference_mean_ = reference_mean_/matches_;
+          return true; 
+        }
+      }
+      return false;
+    }
+    else
+    {
+      shifted_mean_ = shifted_mean_/matches_;
+      reference_mean_ = reference_mean_/matches_;
+      return true;
+    }
+  }
+  else { return false; }
+}
+
+float MapFitterCore::errorSAD()
+{
+  float error = 0;
+  for (int i = 0; i < matches_; i++) 
+  {
+    float shifted = (xy_shifted_[i]-shifted_mean_);
+    float reference = (xy_reference_[i]-reference_mean_);
+    error += fabs(shifted-reference);
+  }
+  return error/matches_;
+}
+
+float MapFitterCore::weightedErrorSAD()
+{
+  float error = 0;
+  float normalization = 0;
+  for (int i = 0; i < matches_; i++) 
+  {
+    float shifted = (xy_shifted_[i]-shifted_mean_);
+    float reference = (xy_reference_[i]-reference_mean_);
+    error += fabs(shifted-reference) / xy_shifted_var_[i];
+    normalization += 1.0/xy_shifted_var_[i];
+  }
+  return error/normalization;
+}
+
+float MapFitterCore::errorSSD()
+{
+  float error = 0;
+  for (int i = 0; i < matches_; i++) 
+  {
+    float shifted = (xy_shifted_[i]-shifted_mean_);
+    float reference = (xy_reference_[i]-reference_mean_);
+    error += (shifted-reference)*(shifted-reference); //sqrt(fabs(shifted-reference)) instead of (shifted-reference)*(shifted-reference)
+  }
+  return error/matches_;
+}
+
+float MapFitterCore::weightedErrorSSD()
+{
+  float error = 0;
+  float normalization = 0;
+  for (int i = 0; i < matches_; i++) 
+  {
+    float shifted = (xy_shifted_[i]-shifted_mean_);
+    float reference = (xy_reference_[i]-reference_mean_);
+    //error += sqrt(fabs(shifted-reference) * xy_shifted_var_[i]);
+    //normalization += sqrt(xy_shifted_var_[i]);
+    error += (shifted-reference)*(shifted-reference) / (xy_shifted_var_[i]*xy_shifted_var_[i]);
+    normalization += 1/(xy_shifted_var_[i]*xy_shifted_var_[i]);
+  }
+  return error/normalization;
+}
+
+float MapFitterCore::correlationNCC()
+{
+  float shifted_normal = 0;
+  float reference_normal = 0;
+  float correlation = 0;
+  for (int i = 0; i < matches_; i++) 
+  {
+    float shifted_corr = (xy_shifted_[i]-shifted_mean_);
+    float reference_corr = (xy_reference_[i]-reference_mean_);
+    correlation += shifted_corr*reference_corr;
+    shifted_normal += shifted_corr*shifted_corr;
+    reference_normal += reference_corr*reference_corr;
+  }
+  return correlation/sqrt(shifted_normal*reference_normal);
+}
+
+float MapFitterCore::weightedCorrelationNCC()
+{
+  float shifted_normal = 0;
+  float reference_normal = 0;
+  float correlation = 0;
+  for (int i = 0; i < matches_; i++) 
+  {
+    float shifted_corr = (xy_shifted_[i]-shifted_mean_);
+    float reference_corr = (xy_reference_[i]-reference_mean_);
+    correlation += shifted_corr*reference_corr / xy_shifted_var_[i];
+    shifted_normal += shifted_corr*shifted_corr / xy_shifted_var_[i];
+    reference_normal += reference_corr*reference_corr / xy_shifted_var_[i];
+  }
+  return correlation/sqrt(shifted_normal*reference_normal);
+}
+
+float MapFitterCore::mutualInformation()
+{
+  float minHeight = map_min_;
+  if (reference_min_ < minHeight) { minHeight = reference_min_; }
+
+  float maxHeight = map_max_;
+  if (reference_max_ > maxHeight) { maxHeight = reference_max_; }
+
+  int numberOfBins = ceil((maxHeight - minHeight)/0.03);
+
+  float binWidth = (maxHeight - minHeight + 1e-6) / numberOfBins;
+
+  std::vector <float> hist;
+  std::vector <float> referenceHist;
+  std::vector< std::vector <float> > jointHist;
+  hist.clear();
+  referenceHist.clear();
+  jointHist.clear();
+  for (int i = 0; i < numberOfBins; i++)
+  {
+    hist.push_back(0.0);
+    referenceHist.push_back(0.0);
+  }
+  for (int i = 0; i < numberOfBins; i++)
+  {
+    jointHist.push_back(hist);
+  }
+
+  for (int i = 0; i < matches_; i++)
+  {
+    int i1 = (xy_shifted_[i] - minHeight) / binWidth;
+    int i2 = (xy_reference_[i] - minHeight) / binWidth;
+    hist[i1] += 1.0/matches_;
+    referenceHist[i2] += 1.0/matches_;
+    jointHist[i1][i2] += 1.0/matches_;
+  }
+
+  float entropy = 0;
+  float referenceEntropy = 0;
+  float jointEntropy = 0;
+
+  for (int i = 0; i < numberOfBins; i++)
+  {
+    if (hist[i]!=0.0) { entropy += -hist[i]*log2(hist[i]); }
+    if (referenceHist[i]!=0.0) { referenceEntropy += -referenceHist[i]*log2(referenceHist[i]); }
+
+    for (int j = 0; j < numberOfBins; j++)
+    {
+      if (jointHist[i][j]!=0.0) 
+      { 
+        jointEntropy += -jointHist[i][j]*log2(jointHist[i][j]);
+      }
+    }
+  }
+  return (entropy+referenceEntropy)-jointEntropy;
+}
+
+float MapFitterCore::normalizedMutualInformation()
+{
+  float minHeight = map_min_;
+  if (reference_min_ < minHeight) { minHeight = reference_min_; }
+
+  float maxHeight = map_max_;
+  if (reference_max_ > maxHeight) { maxHeight = reference_max_; }
+
+  int numberOfBins = ceil((maxHeight - minHeight)/0.08); //128
+
+  float binWidth = (maxHeight - minHeight + 1e-6) / numberOfBins;
+
+  std::vector <float> hist;
+  std::vector <float> referenceHist;
+  std::vector< std::vector <float> > jointHist;
+  hist.clear();
+  referenceHist.clear();
+  jointHist.clear();
+  for (int i = 0; i < numberOfBins; i++)
+  {
+    hist.push_back(0.0);
+    referenceHist.push_back(0.0);
+  }
+  for (int i = 0; i < numberOfBins; i++)
+  {
+    jointHist.push_back(hist);
+  }
+
+  for (int i = 0; i < matches_; i++)
+  {
+    int i1 = (xy_shifted_[i] - minHeight) / binWidth;
+    int i2 = (xy_reference_[i] - minHeight) / binWidth;
+    hist[i1] += 1.0/matches_;
+    referenceHist[i2] += 1.0/matches_;
+    jointHist[i1][i2] += 1.0/matches_;
+  }
+
+  float entropy = 0;
+  float referenceEntropy = 0;
+  float jointEntropy = 0;
+  float weightSum = 0;
+
+  for (int i = 0; i < numberOfBins; i++)
+  {
+    if (hist[i]!=0.0) { entropy += -hist[i]*log2(hist[i]); }
+    if (referenceHist[i]!=0.0) { referenceEntropy += -referenceHist[i]*log2(referenceHist[i]); }
+
+    for (int j = 0; j < numberOfBins; j++)
+    {
+      if (jointHist[i][j]!=0.0) 
+      { 
+        jointEntropy += -jointHist[i][j]*log2(jointHist[i][j]);
+        weightSum += (numberOfBins-abs(i-j))*jointHist[i][j];
+      }
+    }
+  }
+  return (entropy+referenceEntropy)/jointEntropy;
+}
+
+} /* namespace */
@@ -0,0 +1,116 @@
+/*
+ * PerfCounters.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/PerfCounters.h>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace map_fitter {
+
+#ifdef __linux__
+static int openCounter(uint32_t type, uint64_t config)
+{
+  perf_event_attr attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.size = sizeof(attributes);
+  attributes.type = type;
+  attributes.config = config;
+  attributes.disabled = 1;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  // the enabled and running times scale the count if the counters are multiplexed
+  attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+#endif
+
+PerfCounters::PerfCounters()
+{
+  fileDescriptors_.fill(-1);
+#ifdef __linux__
+  const uint64_t l1Misses = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  fileDescriptors_[Cycles] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  int openError = errno;
+  fileDescriptors_[Instructions] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  fileDescriptors_[L1DataMisses] = openCounter(PERF_TYPE_HW_CACHE, l1Misses);
+  fileDescriptors_[LastLevelCacheMisses] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  fileDescriptors_[BranchMisses] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+  if (!isAvailable()) { error_ = std::string("perf_event_open failed: ") + std::strerror(openError); }
+#else
+  error_ = "hardware performance counters are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+  for (int fileDescriptor : fileDescriptors_)
+  {
+    if (fileDescriptor >= 0) { close(fileDescriptor); }
+  }
+#endif
+}
+
+bool PerfCounters::isAvailable() const
+{
+  for (int fileDescriptor : fileDescriptors_)
+  {
+    if (fileDescriptor >= 0) { return true; }
+  }
+  return false;
+}
+
+const std::string& PerfCounters::getError() const
+{
+  return error_;
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+  for (int fileDescriptor : fileDescriptors_)
+  {
+    if (fileDescriptor < 0) { continue; }
+    ioctl(fileDescriptor, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fileDescriptor, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+PerfCounterValues PerfCounters::stop()
+{
+  PerfCounterValues counts;
+#ifdef __linux__
+  for (int i = 0; i < NumberOfPerfCounters; i++)
+  {
+    if (fileDescriptors_[i] < 0) { continue; }
+    ioctl(fileDescriptors_[i], PERF_EVENT_IOC_DISABLE, 0);
+    // value, time enabled, time running
+    uint64_t data[3];
+    if (read(fileDescriptors_[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) { continue; }
+    counts.values[i] = double(data[0]) * double(data[1]) / double(data[2]);
+    counts.valid[i] = true;
+  }
+#endif
+  return counts;
+}
+
+const char* PerfCounters::getName(int counter)
+{
+  static const char* names[NumberOfPerfCounters] = {"cycles", "instructions", "L1D misses", "LLC misses", "branch misses"};
+  return counter >= 0 && counter < NumberOfPerfCounters ? names[counter] : "";
+}
+
+} /* namespace */
@@ -0,0 +1,110 @@
+/*
+ * SyntheticMapPublisher.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/SyntheticMapPublisher.h>
+
+namespace map_fitter {
+
+SyntheticMapPublisher::SyntheticMapPublisher(ros::NodeHandle& nodeHandle)
+    : nodeHandle_(nodeHandle), frame_(0)
+{
+  readParameters();
+  generator_.reset(new TerrainGenerator(terrainParameters_, templateParameters_));
+
+  referencePublisher_ = nodeHandle_.advertise<grid_map_msgs::GridMap>(referenceMapTopic_, 1, true);
+  mapPublisher_ = nodeHandle_.advertise<grid_map_msgs::GridMap>(mapTopic_, 1);
+  groundTruthPublisher_ = nodeHandle_.advertise<geometry_msgs::PointStamped>("ground_truth", 10);
+
+  grid_map_msgs::GridMap referenceMessage;
+  grid_map::GridMapRosConverter::toMessage(generator_->getReferenceMap(), referenceMessage);
+  referenceMessage.info.header.stamp = ros::Time::now();
+  referencePublisher_.publish(referenceMessage);
+  ROS_INFO("Synthetic map publisher published a %.1f m reference map on '%s'.", terrainParameters_.length, referenceMapTopic_.c_str());
+
+  timer_ = nodeHandle_.createTimer(ros::Duration(1.0 / rate_), &SyntheticMapPublisher::publishFrame, this);
+}
+
+SyntheticMapPublisher::~SyntheticMapPublisher()
+{
+}
+
+bool SyntheticMapPublisher::readParameters()
+{
+  nodeHandle_.param("map_topic", mapTopic_, std::string("/elevation_mapping_long_range/elevation_map"));
+  nodeHandle_.param("reference_map_topic", referenceMapTopic_, std::string("/uav_elevation_mapping/uav_elevation_map"));
+  nodeHandle_.param("rate", rate_, 2.0);
+  nodeHandle_.param("number_of_frames", numberOfFrames_, 0);
+  if (rate_ <= 0)
+  {
+    ROS_WARN("Synthetic map publisher needs a positive rate, using 2 Hz.");
+    rate_ = 2.0;
+  }
+
+  int seed;
+  nodeHandle_.param("reference_length", terrainParameters_.length, terrainParameters_.length);
+  nodeHandle_.param("resolution", terrainParameters_.resolution, terrainParameters_.resolution);
+  nodeHandle_.param("fractal_height", terrainParameters_.fractalHeight, terrainParameters_.fractalHeight);
+  nodeHandle_.param("fractal_scale", terrainParameters_.fractalScale, terrainParameters_.fractalScale);
+  nodeHandle_.param("fractal_octaves", terrainParameters_.fractalOctaves, terrainParameters_.fractalOctaves);
+  nodeHandle_.param("number_of_steps", terrainParameters_.numberOfSteps, terrainParameters_.numberOfSteps);
+  nodeHandle_.param("step_height", terrainParameters_.stepHeight, terrainParameters_.stepHeight);
+  nodeHandle_.param("number_of_buildings", terrainParameters_.numberOfBuildings, terrainParameters_.numberOfBuildings);
+  nodeHandle_.param("number_of_holes", terrainParameters_.numberOfHoles, terrainParameters_.numberOfHoles);
+  nodeHandle_.param("hole_max_radius", terrainParameters_.holeMaxRadius, terrainParameters_.holeMaxRadius);
+  nodeHandle_.param("terrain_seed", seed, int(terrainParameters_.seed));
+  terrainParameters_.seed = seed;
+
+  templateParameters_.rate = rate_;
+  nodeHandle_.param("template_length", templateParameters_.length, templateParameters_.length);
+  nodeHandle_.param("speed", templateParameters_.speed, templateParameters_.speed);
+  nodeHandle_.param("height_offset", templateParameters_.heightOffset, templateParameters_.heightOffset);
+  nodeHandle_.param("noise", templateParameters_.noise, templateParameters_.noise);
+  nodeHandle_.param("noise_per_meter", templateParameters_.noisePerMeter, templateParameters_.noisePerMeter);
+  nodeHandle_.param("number_of_occluded_sectors", templateParameters_.numberOfOccludedSectors, templateParameters_.numberOfOccludedSectors);
+  nodeHandle_.param("occluded_sector_angle", templateParameters_.occludedSectorAngle, templateParameters_.occludedSectorAngle);
+  nodeHandle_.param("prior_position_noise", templateParameters_.priorPositionNoise, templateParameters_.priorPositionNoise);
+  nodeHandle_.param("prior_heading_noise", templateParameters_.priorHeadingNoise, templateParameters_.priorHeadingNoise);
+  nodeHandle_.param("prior_offset_x", templateParameters_.priorOffsetX, templateParameters_.priorOffsetX);
+  nodeHandle_.param("prior_offset_y", templateParameters_.priorOffsetY, templateParameters_.priorOffsetY);
+  nodeHandle_.param("template_seed", seed, int(templateParameters_.seed));
+  templateParameters_.seed = seed;
+  return true;
+}
+
+void SyntheticMapPublisher::publishFrame(const ros::TimerEvent& event)
+{
+  if (numberOfFrames_ > 0 && frame_ >= numberOfFrames_)
+  {
+    timer_.stop();
+    ROS_INFO("Synthetic map publisher published all %d template maps.", numberOfFrames_);
+    return;
+  }
+
+  SyntheticFrame syntheticFrame = generator_->generateFrame(frame_);
+  ros::Time stamp = ros::Time::now();
+
+  // the prior goes on tf before the map, the map fitter looks it up when the map arrives
+  tf::Transform prior(tf::createQuaternionFromYaw(syntheticFrame.prior.yaw), tf::Vector3(syntheticFrame.prior.x, syntheticFrame.prior.y, 0));
+  broadcaster_.sendTransform(tf::StampedTransform(prior, stamp, "map", "base"));
+
+  geometry_msgs::PointStamped groundTruth;
+  groundTruth.header.stamp = stamp;
+  groundTruth.header.frame_id = "map";
+  groundTruth.point.x = syntheticFrame.groundTruth.x;
+  groundTruth.point.y = syntheticFrame.groundTruth.y;
+  groundTruth.point.z = syntheticFrame.groundTruth.yaw / M_PI * 180;
+  groundTruthPublisher_.publish(groundTruth);
+
+  grid_map_msgs::GridMapPtr message = boost::make_shared<grid_map_msgs::GridMap>();
+  grid_map::GridMapRosConverter::toMessage(syntheticFrame.map, *message);
+  message->info.header.stamp = stamp;
+  mapPublisher_.publish(message);
+  frame_++;
+}
+
+} /* namespace */
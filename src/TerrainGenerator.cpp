@@ -0,0 +1,245 @@
+/*
+ * TerrainGenerator.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/TerrainGenerator.h>
+#include <grid_map_core/iterators/GridMapIterator.hpp>
+#include <Eigen/Geometry>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+namespace map_fitter {
+
+/*!
+ * Integer hash of a lattice point, gives the same value for the same seed.
+ */
+static uint32_t hashLattice(int x, int y, int octave, unsigned int seed)
+{
+  uint32_t hash = seed * 0x9E3779B9u;
+  hash ^= uint32_t(x) * 0x85EBCA6Bu;
+  hash = (hash << 13) | (hash >> 19);
+  hash ^= uint32_t(y) * 0xC2B2AE35u;
+  hash = (hash << 17) | (hash >> 15);
+  hash ^= uint32_t(octave) * 0x27D4EB2Fu;
+  hash ^= hash >> 16;
+  hash *= 0x7FEB352Du;
+  hash ^= hash >> 15;
+  hash *= 0x846CA68Bu;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+TerrainGenerator::TerrainGenerator(const TerrainParameters& terrainParameters, const TemplateParameters& templateParameters)
+    : terrainParameters_(terrainParameters),
+      templateParameters_(templateParameters),
+      generator_(templateParameters.seed)
+{
+  generateReferenceMap();
+}
+
+TerrainGenerator::~TerrainGenerator()
+{
+}
+
+const grid_map::GridMap& TerrainGenerator::getReferenceMap() const
+{
+  return referenceMap_;
+}
+
+double TerrainGenerator::valueNoise(double x, double y, int octave) const
+{
+  int x0 = int(floor(x));
+  int y0 = int(floor(y));
+  double fx = x - x0;
+  double fy = y - y0;
+  // smoothstep to avoid creases at the lattice lines
+  fx = fx * fx * (3 - 2 * fx);
+  fy = fy * fy * (3 - 2 * fy);
+  auto value = [&](int ix, int iy) { return hashLattice(ix, iy, octave, terrainParameters_.seed) / double(std::numeric_limits<uint32_t>::max()) * 2 - 1; };
+  double bottom = value(x0, y0) * (1 - fx) + value(x0 + 1, y0) * fx;
+  double top = value(x0, y0 + 1) * (1 - fx) + value(x0 + 1, y0 + 1) * fx;
+  return bottom * (1 - fy) + top * fy;
+}
+
+double TerrainGenerator::fractalNoise(double x, double y) const
+{
+  double sum = 0;
+  double amplitudes = 0;
+  double amplitude = 1;
+  double frequency = 1.0 / terrainParameters_.fractalScale;
+  for (int octave = 0; octave < terrainParameters_.fractalOctaves; octave++)
+  {
+    sum += amplitude * valueNoise(x * frequency, y * frequency, octave);
+    amplitudes += amplitude;
+    amplitude *= terrainParameters_.fractalPersistence;
+    frequency *= 2;
+  }
+  return amplitudes > 0 ? sum / amplitudes : 0;
+}
+
+void TerrainGenerator::generateReferenceMap()
+{
+  std::default_random_engine generator(terrainParameters_.seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const double length = terrainParameters_.length;
+
+  referenceMap_ = grid_map::GridMap({"elevation"});
+  referenceMap_.setGeometry(grid_map::Length::Constant(length), terrainParameters_.resolution);
+  referenceMap_.setFrameId("map");
+  grid_map::Matrix& elevation = referenceMap_.get("elevation");
+
+  // straight steps: lines through the map with a height difference between their sides
+  std::vector<Eigen::Vector3d> steps;
+  for (int i = 0; i < terrainParameters_.numberOfSteps; i++)
+  {
+    double angle = unit(generator) * 2 * M_PI;
+    double offset = (unit(generator) - 0.5) * length;
+    steps.push_back(Eigen::Vector3d(cos(angle), sin(angle), offset));
+  }
+
+  for (grid_map::GridMapIterator iterator(referenceMap_); !iterator.isPastEnd(); ++iterator)
+  {
+    grid_map::Position position;
+    referenceMap_.getPosition(*iterator, position);
+    double height = terrainParameters_.fractalHeight * fractalNoise(position.x(), position.y());
+    for (const Eigen::Vector3d& step : steps)
+    {
+      if (step.x() * position.x() + step.y() * position.y() > step.z()) { height += terrainParameters_.stepHeight; }
+    }
+    elevation((*iterator)(0), (*iterator)(1)) = height;
+  }
+
+  // buildings: rotated boxes with a flat roof above the ground at their center
+  for (int i = 0; i < terrainParameters_.numberOfBuildings; i++)
+  {
+    grid_map::Position center((unit(generator) - 0.5) * length, (unit(generator) - 0.5) * length);
+    double sizeX = terrainParameters_.buildingMinSize + unit(generator) * (terrainParameters_.buildingMaxSize - terrainParameters_.buildingMinSize);
+    double sizeY = terrainParameters_.buildingMinSize + unit(generator) * (terrainParameters_.buildingMaxSize - terrainParameters_.buildingMinSize);
+    double height = terrainParameters_.buildingMinHeight + unit(generator) * (terrainParameters_.buildingMaxHeight - terrainParameters_.buildingMinHeight);
+    double angle = unit(generator) * M_PI;
+    if (!referenceMap_.isInside(center)) { continue; }
+    float roof = referenceMap_.atPosition("elevation", center) + height;
+    for (grid_map::GridMapIterator iterator(referenceMap_); !iterator.isPastEnd(); ++iterator)
+    {
+      grid_map::Position position;
+      referenceMap_.getPosition(*iterator, position);
+      grid_map::Position offset = position - center;
+      double u = cos(angle) * offset.x() + sin(angle) * offset.y();
+      double v = -sin(angle) * offset.x() + cos(angle) * offset.y();
+      if (fabs(u) <= sizeX / 2 && fabs(v) <= sizeY / 2) { elevation((*iterator)(0), (*iterator)(1)) = roof; }
+    }
+  }
+
+  // holes without data
+  for (int i = 0; i < terrainParameters_.numberOfHoles; i++)
+  {
+    grid_map::Position center((unit(generator) - 0.5) * length, (unit(generator) - 0.5) * length);
+    double radius = unit(generator) * terrainParameters_.holeMaxRadius;
+    for (grid_map::GridMapIterator iterator(referenceMap_); !iterator.isPastEnd(); ++iterator)
+    {
+      grid_map::Position position;
+      referenceMap_.getPosition(*iterator, position);
+      if ((position - center).norm() <= radius) { elevation((*iterator)(0), (*iterator)(1)) = NAN; }
+    }
+  }
+}
+
+PriorPose TerrainGenerator::getTrajectoryPose(int frame) const
+{
+  const grid_map::Position center = referenceMap_.getPosition();
+  const double a = 0.35 * terrainParameters_.length;
+  const double b = 0.25 * terrainParameters_.length;
+  // the parameter of the ellipse advances with the distance over the mean radius
+  double distance = templateParameters_.speed * frame / templateParameters_.rate;
+  double t = distance / ((a + b) / 2);
+
+  PriorPose pose;
+  pose.x = center.x() + a * cos(t);
+  pose.y = center.y() + b * sin(t);
+  pose.yaw = atan2(b * cos(t), -a * sin(t));
+  return pose;
+}
+
+SyntheticFrame TerrainGenerator::generateFrame(int frame)
+{
+  std::normal_distribution<double> positionNoise(0.0, templateParameters_.priorPositionNoise);
+  std::normal_distribution<double> headingNoise(0.0, templateParameters_.priorHeadingNoise / 180 * M_PI);
+
+  SyntheticFrame syntheticFrame;
+  syntheticFrame.groundTruth = getTrajectoryPose(frame);
+  syntheticFrame.prior = syntheticFrame.groundTruth;
+  syntheticFrame.prior.x += templateParameters_.priorOffsetX;
+  syntheticFrame.prior.y += templateParameters_.priorOffsetY;
+  if (templateParameters_.priorPositionNoise > 0)
+  {
+    syntheticFrame.prior.x += positionNoise(generator_);
+    syntheticFrame.prior.y += positionNoise(generator_);
+  }
+  if (templateParameters_.priorHeadingNoise > 0) { syntheticFrame.prior.yaw += headingNoise(generator_); }
+
+  extractTemplate(syntheticFrame.groundTruth, syntheticFrame.prior, syntheticFrame.map);
+  syntheticFrame.map.setTimestamp(uint64_t(frame / templateParameters_.rate * 1e9));
+  return syntheticFrame;
+}
+
+void TerrainGenerator::extractTemplate(const PriorPose& groundTruth, const PriorPose& prior, grid_map::GridMap& templateMap)
+{
+  std::normal_distribution<float> normal(0.0, 1.0);
+  std::uniform_real_distribution<double> bearing(-M_PI, M_PI);
+
+  templateMap = grid_map::GridMap({"elevation", "variance"});
+  templateMap.setGeometry(grid_map::Length::Constant(templateParameters_.length), referenceMap_.getResolution(), grid_map::Position(prior.x, prior.y));
+  templateMap.setFrameId("odom");
+
+  std::vector<double> sectors;
+  for (int i = 0; i < templateParameters_.numberOfOccludedSectors; i++) { sectors.push_back(bearing(generator_)); }
+  const double halfSectorAngle = templateParameters_.occludedSectorAngle / 360 * M_PI;
+
+  // the template map is aligned with the prior heading, the matching finds the rotation of the heading error
+  const double rotation = groundTruth.yaw - prior.yaw;
+  const Eigen::Rotation2Dd toReference(rotation);
+  const grid_map::Position center(prior.x, prior.y);
+  const grid_map::Position truePosition(groundTruth.x, groundTruth.y);
+
+  grid_map::Matrix& elevation = templateMap.get("elevation");
+  grid_map::Matrix& variance = templateMap.get("variance");
+  for (grid_map::GridMapIterator iterator(templateMap); !iterator.isPastEnd(); ++iterator)
+  {
+    const grid_map::Index index(*iterator);
+    grid_map::Position position;
+    templateMap.getPosition(index, position);
+    const grid_map::Position offset = position - center;
+    const grid_map::Position referencePosition = truePosition + toReference * offset;
+
+    bool occluded = false;
+    if (offset.norm() > templateParameters_.occlusionDistance)
+    {
+      double angle = atan2(offset.y(), offset.x());
+      for (double sector : sectors)
+      {
+        if (fabs(remainder(angle - sector, 2 * M_PI)) <= halfSectorAngle) { occluded = true; }
+      }
+    }
+
+    float height = NAN;
+    if (!occluded && referenceMap_.isInside(referencePosition)) { height = referenceMap_.atPosition("elevation", referencePosition); }
+    if (std::isnan(height))
+    {
+      elevation(index(0), index(1)) = NAN;
+      variance(index(0), index(1)) = NAN;
+      continue;
+    }
+
+    // the noise increases with the distance to the sensor
+    float sigma = templateParameters_.noise + templateParameters_.noisePerMeter * offset.norm();
+    elevation(index(0), index(1)) = height + templateParameters_.heightOffset + sigma * normal(generator_);
+    variance(index(0), index(1)) = sigma * sigma;
+  }
+}
+
+} /* namespace */
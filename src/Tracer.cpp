@@ -0,0 +1,150 @@
+/*
+ * Tracer.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/Tracer.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+
+namespace map_fitter {
+
+static std::string escapeJson(const std::string& value)
+{
+  std::string escaped;
+  for (char c : value)
+  {
+    if (c == '"' || c == '\\') { escaped += '\\'; }
+    if (static_cast<unsigned char>(c) >= 0x20) { escaped += c; }
+  }
+  return escaped;
+}
+
+Tracer& Tracer::instance()
+{
+  static Tracer tracer;
+  return tracer;
+}
+
+Tracer::Tracer()
+    : enabled_(false), bufferSize_(65536), startTime_(std::chrono::steady_clock::now())
+{
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::setBufferSize(size_t bufferSize)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  bufferSize_ = std::max<size_t>(bufferSize, 1);
+}
+
+Tracer::ThreadBuffer& Tracer::threadBuffer()
+{
+  // registered once per thread, the buffer outlives the thread
+  thread_local ThreadBuffer* buffer = nullptr;
+  if (buffer == nullptr)
+  {
+    std::shared_ptr<ThreadBuffer> newBuffer = std::make_shared<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock(mutex_);
+    newBuffer->events.reset(new EventSlot[bufferSize_]);
+    newBuffer->size = bufferSize_;
+    newBuffer->written = 0;
+    newBuffer->threadId = buffers_.size() + 1;
+    buffers_.push_back(newBuffer);
+    buffer = newBuffer.get();
+  }
+  return *buffer;
+}
+
+void Tracer::setThreadName(const std::string& name)
+{
+  ThreadBuffer& buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer.threadName = name;
+}
+
+void Tracer::record(const char* name, const std::chrono::steady_clock::time_point& start, const std::chrono::steady_clock::time_point& end)
+{
+  ThreadBuffer& buffer = threadBuffer();
+  uint64_t written = buffer.written.load(std::memory_order_relaxed);
+  EventSlot& event = buffer.events[written % buffer.size];
+  // a reader that sees a field of this event also sees the number of written events before it
+  std::atomic_thread_fence(std::memory_order_release);
+  event.name.store(name, std::memory_order_relaxed);
+  event.start.store(std::chrono::duration_cast<std::chrono::nanoseconds>(start - startTime_).count(), std::memory_order_relaxed);
+  event.duration.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), std::memory_order_relaxed);
+  buffer.written.store(written + 1, std::memory_order_release);
+}
+
+bool Tracer::writeChromeTrace(const std::string& path) const
+{
+  std::ofstream file(path);
+  if (!file)
+  {
+    std::cerr << "Could not open " << path << " for writing the trace." << std::endl;
+    return false;
+  }
+
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers = buffers_;
+  }
+
+  const int pid = getpid();
+  bool first = true;
+  size_t numberOfEvents = 0;
+  file << "{\"traceEvents\":[";
+  file << std::fixed << std::setprecision(3);
+  for (const std::shared_ptr<ThreadBuffer>& buffer : buffers)
+  {
+    std::string threadName;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      threadName = buffer->threadName;
+    }
+    if (!threadName.empty())
+    {
+      file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->threadId
+           << ",\"args\":{\"name\":\"" << escapeJson(threadName) << "\"}}";
+      first = false;
+    }
+
+    // the thread keeps writing, events overwritten during the copy and the slot it may be writing are left out
+    const uint64_t size = buffer->size;
+    const uint64_t writtenBefore = buffer->written.load(std::memory_order_acquire);
+    std::vector<Event> events(size);
+    for (uint64_t i = 0; i < size; i++)
+    {
+      events[i].name = buffer->events[i].name.load(std::memory_order_relaxed);
+      events[i].start = buffer->events[i].start.load(std::memory_order_relaxed);
+      events[i].duration = buffer->events[i].duration.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t writtenAfter = buffer->written.load(std::memory_order_relaxed);
+    const uint64_t oldest = writtenAfter + 1 > size ? writtenAfter + 1 - size : 0;
+    for (uint64_t i = oldest; i < writtenBefore; i++)
+    {
+      const Event& event = events[i % size];
+      file << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->threadId
+           << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+      first = false;
+      numberOfEvents += 1;
+    }
+  }
+  file << "\n]}" << std::endl;
+  std::cout << "Wrote " << numberOfEvents << " trace events to " << path << "." << std::endl;
+  return static_cast<bool>(file);
+}
+
+} /* namespace */
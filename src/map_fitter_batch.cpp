@@ -0,0 +1,403 @@
+/*
+ * map_fitter_batch.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/MapFitterCore.h>
+#include <map_fitter/GridMapBinaryConverter.h>
+#include <map_fitter/LatencyStatistics.h>
+#include <map_fitter/Tracer.h>
+#include <map_fitter/AsyncLogger.h>
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <tf/tf.h>
+#include <tf2_msgs/TFMessage.h>
+#include <grid_map_ros/GridMapRosConverter.hpp>
+#include <grid_map_msgs/GridMap.h>
+#include <dirent.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace map_fitter {
+
+/*!
+ * Options of the batch run.
+ */
+struct BatchOptions
+{
+  std::string referencePath;
+  std::string referenceTopic = "/uav_elevation_mapping/uav_elevation_map";
+  std::string mapTopic = "/elevation_mapping_long_range/elevation_map";
+  std::string outputDirectory = ".";
+  int jobs = 1;
+  std::string traceFile;
+  MapFitterParameters parameters;
+  std::vector<std::string> sequences;
+};
+
+//! Called for each template map of a sequence with its prior pose (false if there is none).
+typedef std::function<void(const grid_map::GridMap&, const PriorPose&, bool)> FrameCallback;
+
+static std::mutex outputMutex;
+
+static bool endsWith(const std::string& text, const std::string& suffix)
+{
+  return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::string sequenceName(const std::string& path)
+{
+  std::string name = path;
+  while (name.size() > 1 && name.back() == '/') { name.pop_back(); }
+  name = name.substr(name.find_last_of('/') + 1);
+  if (endsWith(name, ".bag")) { name.resize(name.size() - 4); }
+  return name;
+}
+
+/*!
+ * Sets a parameter by the name it has in map_fitter.yaml.
+ * @return false if the parameter is unknown.
+ */
+static bool setParameter(MapFitterParameters& parameters, const std::string& name, const std::string& value)
+{
+  std::istringstream stream(value);
+  if (name == "number_of_particles") { stream >> parameters.numberOfParticles; }
+  else if (name == "angle_increment") { stream >> parameters.angleIncrement; }
+  else if (name == "position_increment_search") { stream >> parameters.searchIncrement; }
+  else if (name == "position_increment_correlation") { stream >> parameters.correlationIncrement; }
+  else if (name == "required_overlap") { stream >> parameters.requiredOverlap; }
+  else if (name == "SAD_threshold") { stream >> parameters.SADThreshold; }
+  else if (name == "SSD_threshold") { stream >> parameters.SSDThreshold; }
+  else if (name == "NCC_threshold") { stream >> parameters.NCCThreshold; }
+  else if (name == "MI_threshold") { stream >> parameters.MIThreshold; }
+  else if (name == "rho_SAD") { stream >> parameters.rhoSAD; }
+  else if (name == "rho_SSD") { stream >> parameters.rhoSSD; }
+  else if (name == "rho_NCC") { stream >> parameters.rhoNCC; }
+  else if (name == "rho_MI") { stream >> parameters.rhoMI; }
+  else if (name == "weighted") { stream >> std::boolalpha >> parameters.weighted; }
+  else if (name == "resample") { stream >> std::boolalpha >> parameters.resample; }
+  else if (name == "perf_counters") { stream >> std::boolalpha >> parameters.perfCounters; }
+  else if (name == "log_interval") { stream >> parameters.logInterval; }
+  else if (name == "adaptive_particles") { stream >> std::boolalpha >> parameters.adaptiveParticles; }
+  else if (name == "minimum_number_of_particles") { stream >> parameters.minimumNumberOfParticles; }
+  else if (name == "kld_bin_size") { stream >> parameters.kldBinSize; }
+  else if (name == "kld_angle_bin_size") { stream >> parameters.kldAngleBinSize; }
+  else if (name == "kld_epsilon") { stream >> parameters.kldEpsilon; }
+  else if (name == "kld_quantile") { stream >> parameters.kldQuantile; }
+  else if (name == "tracking") { stream >> std::boolalpha >> parameters.tracking; }
+  else if (name == "tracking_position_spread") { stream >> parameters.trackingPositionSpread; }
+  else if (name == "tracking_angle_spread") { stream >> parameters.trackingAngleSpread; }
+  else if (name == "tracking_particles") { stream >> parameters.trackingParticles; }
+  else if (name == "tracking_correlation_increment") { stream >> parameters.trackingCorrelationIncrement; }
+  else if (name == "tracking_window") { stream >> parameters.trackingWindow; }
+  else if (name == "tracking_angle_window") { stream >> parameters.trackingAngleWindow; }
+  else if (name == "tracking_score_drop") { stream >> parameters.trackingScoreDrop; }
+  else if (name == "local_reinitialization") { stream >> std::boolalpha >> parameters.localReinitialization; }
+  else if (name == "recovery_window") { stream >> parameters.recoveryWindow; }
+  else if (name == "recovery_angle_window") { stream >> parameters.recoveryAngleWindow; }
+  else if (name == "reference_storage_resolution") { stream >> parameters.referenceStorageResolution; }
+  else if (name == "reference_storage")
+  {
+    if (value == "float16") { parameters.referenceStorageType = grid_map::StorageType::Float16; }
+    else if (value == "int16") { parameters.referenceStorageType = grid_map::StorageType::ScaledInt16; }
+    else if (value == "float32") { parameters.referenceStorageType = grid_map::StorageType::Float32; }
+    else { return false; }
+  }
+  else { return false; }
+  return !stream.fail();
+}
+
+static bool loadReferenceMap(const BatchOptions& options, grid_map::GridMap& referenceMap)
+{
+  if (endsWith(options.referencePath, ".bag"))
+  {
+    return grid_map::GridMapRosConverter::loadFromBag(options.referencePath, options.referenceTopic, referenceMap);
+  }
+  return GridMapBinaryConverter::loadFromFile(options.referencePath, referenceMap);
+}
+
+/*!
+ * Reads the template maps of a bag, the prior poses are the ground truth transforms from map to base on /tf.
+ */
+static bool readBag(const std::string& path, const BatchOptions& options, const FrameCallback& callback)
+{
+  rosbag::Bag bag;
+  try { bag.open(path, rosbag::bagmode::Read); }
+  catch (rosbag::BagException& exception)
+  {
+    std::cerr << "Could not open " << path << ": " << exception.what() << std::endl;
+    return false;
+  }
+
+  // the ground truth of the whole bag is read first, then the maps are matched one by one
+  rosbag::View tfView(bag, rosbag::TopicQuery("/tf"));
+  tf::Transformer transformer(true, ros::Duration(std::max(1.0, (tfView.getEndTime() - tfView.getBeginTime()).toSec() + 1.0)));
+  for (const rosbag::MessageInstance& message : tfView)
+  {
+    tf2_msgs::TFMessage::ConstPtr transforms = message.instantiate<tf2_msgs::TFMessage>();
+    if (!transforms) { continue; }
+    for (const geometry_msgs::TransformStamped& transformMsg : transforms->transforms)
+    {
+      tf::StampedTransform transform;
+      tf::transformStampedMsgToTF(transformMsg, transform);
+      transformer.setTransform(transform, "bag");
+    }
+  }
+
+  rosbag::View mapView(bag, rosbag::TopicQuery(options.mapTopic));
+  for (const rosbag::MessageInstance& message : mapView)
+  {
+    grid_map_msgs::GridMap::ConstPtr mapMsg = message.instantiate<grid_map_msgs::GridMap>();
+    if (!mapMsg) { continue; }
+    grid_map::GridMap map;
+    if (!grid_map::GridMapRosConverter::fromMessage(*mapMsg, map)) { continue; }
+
+    PriorPose prior;
+    bool hasPrior = true;
+    try
+    {
+      tf::StampedTransform position;
+      transformer.lookupTransform("/map", "/base", mapMsg->info.header.stamp, position);
+      tf::Matrix3x3 m(position.getRotation());
+      double roll, pitch, yaw;
+      m.getRPY(roll, pitch, yaw);
+      prior.x = position.getOrigin().x();
+      prior.y = position.getOrigin().y();
+      prior.yaw = yaw;
+    }
+    catch (tf::TransformException& exception) { hasPrior = false; }
+    callback(map, prior, hasPrior);
+  }
+  bag.close();
+  return true;
+}
+
+/*!
+ * Reads the binary template maps (*.gridmap) of a directory in the order of their names,
+ * the prior poses are read from poses.txt ("<file> <x> <y> <yaw>" per line).
+ */
+static bool readDirectory(const std::string& path, const FrameCallback& callback)
+{
+  DIR* directory = opendir(path.c_str());
+  if (directory == nullptr)
+  {
+    std::cerr << "Could not open " << path << "." << std::endl;
+    return false;
+  }
+  std::vector<std::string> files;
+  while (struct dirent* entry = readdir(directory))
+  {
+    std::string file = entry->d_name;
+    if (endsWith(file, ".gridmap")) { files.push_back(file); }
+  }
+  closedir(directory);
+  std::sort(files.begin(), files.end());
+
+  std::map<std::string, PriorPose> priors;
+  std::ifstream posesFile(path + "/poses.txt");
+  std::string line;
+  while (std::getline(posesFile, line))
+  {
+    std::istringstream stream(line);
+    std::string file;
+    PriorPose prior;
+    if (stream >> file >> prior.x >> prior.y >> prior.yaw) { priors[file] = prior; }
+  }
+
+  for (const std::string& file : files)
+  {
+    grid_map::GridMap map;
+    if (!GridMapBinaryConverter::loadFromFile(path + "/" + file, map)) { continue; }
+    auto prior = priors.find(file);
+    if (prior == priors.end()) { callback(map, PriorPose(), false); }
+    else { callback(map, prior->second, true); }
+  }
+  return true;
+}
+
+/*!
+ * Matches all template maps of a sequence back-to-back and writes the estimates to <name>.csv.
+ */
+static bool runSequence(const std::string& sequence, const BatchOptions& options, const grid_map::GridMap& referenceMap)
+{
+  const std::string name = sequenceName(sequence);
+  std::ofstream csv(options.outputDirectory + "/" + name + ".csv");
+  if (!csv)
+  {
+    std::cerr << "Could not write " << options.outputDirectory << "/" << name << ".csv." << std::endl;
+    return false;
+  }
+  csv << "frame,stamp,metric,valid,x,y,theta,z,score,processing_time" << std::endl;
+
+  MapFitterCore core(options.parameters);
+  core.setReferenceMap(referenceMap);
+
+  int frame = 0;
+  int framesWithoutPrior = 0;
+  double processingTime = 0;
+  double maxProcessingTime = 0;
+  // the window covers the whole sequence
+  LatencyStatistics statistics(1000000);
+  std::map<std::string, KernelCounters> kernelCounters;
+  std::vector<MatchEstimate> estimates;
+  FrameCallback callback = [&](const grid_map::GridMap& map, const PriorPose& prior, bool hasPrior)
+  {
+    if (!hasPrior) { framesWithoutPrior += 1; }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool success = core.match(map, prior, estimates);
+    double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    processingTime += duration;
+    maxProcessingTime = std::max(maxProcessingTime, duration);
+    if (success)
+    {
+      statistics.add(core.getStageDurations());
+      for (const auto& stage : core.getKernelCounters())
+      {
+        kernelCounters[stage.first].counters += stage.second.counters;
+        kernelCounters[stage.first].particles += stage.second.particles;
+        kernelCounters[stage.first].cells += stage.second.cells;
+      }
+      for (const MatchEstimate& estimate : estimates)
+      {
+        csv << frame << "," << map.getTimestamp() << "," << estimate.metric << "," << estimate.valid << "," << estimate.x << "," << estimate.y << ","
+            << estimate.theta << "," << estimate.z << "," << estimate.score << "," << duration << std::endl;
+      }
+    }
+    frame += 1;
+  };
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool success = endsWith(sequence, ".bag") ? readBag(sequence, options, callback) : readDirectory(sequence, callback);
+  double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // the verbose printouts of the matches come before the summary
+  AsyncLogger::instance().flush();
+  std::lock_guard<std::mutex> lock(outputMutex);
+  std::cout << name << ": " << frame << " maps in " << wallTime << " s";
+  if (frame > 0) { std::cout << " (matching mean " << processingTime / frame << " s, max " << maxProcessingTime << " s)"; }
+  std::cout << std::endl;
+  if (framesWithoutPrior > 0) { std::cout << "  " << framesWithoutPrior << " maps without ground truth (prior at the origin)" << std::endl; }
+  for (const StagePercentiles& stage : statistics.getPercentiles())
+  {
+    std::cout << "  " << stage.stage << " p50/p95/p99/max: " << stage.p50 * 1000 << " / " << stage.p95 * 1000 << " / " << stage.p99 * 1000 << " / " << stage.max * 1000 << " ms" << std::endl;
+  }
+  for (const auto& stage : kernelCounters)
+  {
+    std::cout << "  " << stage.first << " per particle / per cell:";
+    for (int i = 0; i < NumberOfPerfCounters; i++)
+    {
+      if (!stage.second.counters.valid[i]) { continue; }
+      std::cout << " " << PerfCounters::getName(i) << " " << stage.second.counters.values[i] / std::max(stage.second.particles, 1.0)
+                << " / " << stage.second.counters.values[i] / std::max(stage.second.cells, 1.0);
+    }
+    std::cout << std::endl;
+  }
+  for (const char* metric : {"SAD", "SSD", "NCC", "MI"})
+  {
+    std::cout << "  Cumulative error " << metric << ": " << core.getCumulativeError(metric) << " matches: " << core.getNumberOfCorrectMatches(metric) << std::endl;
+  }
+  return success;
+}
+
+static void printUsage()
+{
+  std::cout << "Usage: map_fitter_batch --reference <map.bag|map.gridmap> [options] <sequence>...\n"
+            << "  A sequence is a bag (template maps and ground truth map -> base on /tf) or a directory\n"
+            << "  of binary template maps (*.gridmap) with poses.txt (\"<file> <x> <y> <yaw>\" per line).\n"
+            << "Options:\n"
+            << "  --reference-topic <topic>  topic of the reference map in the bag\n"
+            << "  --map-topic <topic>        topic of the template maps in the bags\n"
+            << "  --output <directory>       directory of the <sequence>.csv files (default .)\n"
+            << "  --jobs <n>                 number of sequences matched in parallel (default 1)\n"
+            << "  --set <name>=<value>       matching parameter as in map_fitter.yaml\n"
+            << "  --trace <file>             write the trace events of the matching as Chrome trace JSON\n"
+            << "  --perf-counters            read hardware performance counters around the scoring\n"
+            << "  --verbose                  print the scores of each match" << std::endl;
+}
+
+static bool parseArguments(int argc, char** argv, BatchOptions& options)
+{
+  options.parameters.verbose = false;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string argument = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (argument == "--reference" && hasValue) { options.referencePath = argv[++i]; }
+    else if (argument == "--reference-topic" && hasValue) { options.referenceTopic = argv[++i]; }
+    else if (argument == "--map-topic" && hasValue) { options.mapTopic = argv[++i]; }
+    else if (argument == "--output" && hasValue) { options.outputDirectory = argv[++i]; }
+    else if (argument == "--jobs" && hasValue) { options.jobs = std::max(1, atoi(argv[++i])); }
+    else if (argument == "--trace" && hasValue) { options.traceFile = argv[++i]; }
+    else if (argument == "--perf-counters") { options.parameters.perfCounters = true; }
+    else if (argument == "--verbose") { options.parameters.verbose = true; }
+    else if (argument == "--set" && hasValue)
+    {
+      std::string assignment = argv[++i];
+      size_t separator = assignment.find('=');
+      if (separator == std::string::npos || !setParameter(options.parameters, assignment.substr(0, separator), assignment.substr(separator + 1)))
+      {
+        std::cerr << "Invalid parameter '" << assignment << "'." << std::endl;
+        return false;
+      }
+    }
+    else if (argument.compare(0, 2, "--") != 0) { options.sequences.push_back(argument); }
+    else
+    {
+      std::cerr << "Unknown option '" << argument << "'." << std::endl;
+      return false;
+    }
+  }
+  return !options.referencePath.empty() && !options.sequences.empty();
+}
+
+} /* namespace */
+
+int main(int argc, char** argv)
+{
+  map_fitter::BatchOptions options;
+  if (!map_fitter::parseArguments(argc, argv, options))
+  {
+    map_fitter::printUsage();
+    return 1;
+  }
+  // no ROS master needed, the time is only used for the bag timestamps
+  ros::Time::init();
+  map_fitter::Tracer::instance().setEnabled(!options.traceFile.empty());
+
+  grid_map::GridMap referenceMap;
+  if (!map_fitter::loadReferenceMap(options, referenceMap) || !referenceMap.exists("elevation"))
+  {
+    std::cerr << "Could not load a reference map with an elevation layer from " << options.referencePath << "." << std::endl;
+    return 1;
+  }
+
+  // independent sequences run in parallel, each with its own particle filters and random numbers, such that the results do not depend on --jobs
+  std::atomic<size_t> nextSequence(0);
+  std::atomic<bool> success(true);
+  auto worker = [&]()
+  {
+    map_fitter::Tracer::instance().setThreadName("batch worker");
+    for (size_t i = nextSequence++; i < options.sequences.size(); i = nextSequence++)
+    {
+      if (!map_fitter::runSequence(options.sequences[i], options, referenceMap)) { success = false; }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int i = 1; i < std::min<int>(options.jobs, options.sequences.size()); i++) { workers.emplace_back(worker); }
+  worker();
+  for (std::thread& thread : workers) { thread.join(); }
+  if (!options.traceFile.empty() && !map_fitter::Tracer::instance().writeChromeTrace(options.traceFile)) { success = false; }
+  return success ? 0 : 1;
+}
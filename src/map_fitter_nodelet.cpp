@@ -0,0 +1,32 @@
+/*
+ * map_fitter_nodelet.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <map_fitter/MapFitter.h>
+
+namespace map_fitter {
+
+/*!
+ * Nodelet version of the map fitter node. Maps and results are passed as shared
+ * pointers when the publishers and subscribers run in the same nodelet manager.
+ */
+class MapFitterNodelet : public nodelet::Nodelet
+{
+private:
+    virtual void onInit()
+    {
+      mapFitter_.reset(new MapFitter(getPrivateNodeHandle()));
+    }
+
+    boost::shared_ptr<MapFitter> mapFitter_;
+};
+
+} /* namespace */
+
+PLUGINLIB_EXPORT_CLASS(map_fitter::MapFitterNodelet, nodelet::Nodelet)
@@ -0,0 +1,438 @@
+/*
+ * map_fitter_regression.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <map_fitter/MapFitterCore.h>
+#include <map_fitter/TerrainGenerator.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace map_fitter {
+
+/*!
+ * Synthetic terrain and template stream, fixed so that runs are comparable.
+ */
+struct Scenario
+{
+  std::string name;
+  TerrainParameters terrain;
+  TemplateParameters templates;
+  int numberOfFrames;
+};
+
+/*!
+ * Matching parameters under test.
+ */
+struct Configuration
+{
+  std::string name;
+  MapFitterParameters parameters;
+};
+
+/*!
+ * Accuracy and cost of one metric with one configuration on one scenario.
+ */
+struct RegressionResult
+{
+  std::string scenario;
+  std::string configuration;
+  std::string metric;
+  int frames = 0;
+  int valid = 0;
+  double successRate = 0.0;
+  //! Mean errors of the valid estimates [m], [deg].
+  double positionError = 0.0;
+  double headingError = 0.0;
+  //! Processor time (all threads) and wall time per frame [s].
+  double cpuTime = 0.0;
+  double wallTime = 0.0;
+
+  std::string key() const { return scenario + "/" + configuration + "/" + metric; }
+};
+
+/*!
+ * Options of the regression run.
+ */
+struct RegressionOptions
+{
+  std::vector<std::string> scenarios;
+  std::string outputDirectory;
+  std::string baselinePath;
+  std::string writeBaselinePath;
+  //! An estimate is a success if it is closer to the ground truth than this [m], [deg].
+  double successDistance = 0.5;
+  double successAngle = 5.0;
+  //! Allowed absolute changes of the accuracy.
+  double successRateTolerance = 0.05;
+  double positionErrorTolerance = 0.1;
+  double headingErrorTolerance = 1.0;
+  //! Allowed relative increase of the processor time per frame, negative to not compare it.
+  double timeTolerance = 0.3;
+  //! Number of runs of each scenario, the fastest one is compared.
+  int repetitions = 3;
+  //! Metrics of which only the processor time is compared, MI does not localize in any scenario.
+  std::vector<std::string> timingOnlyMetrics = {"MI"};
+};
+
+static std::vector<Scenario> getScenarios()
+{
+  std::vector<Scenario> scenarios;
+
+  Scenario hills;
+  hills.name = "hills";
+  hills.terrain.length = 12.8;
+  hills.terrain.resolution = 0.1;
+  hills.terrain.numberOfSteps = 0;
+  hills.terrain.numberOfBuildings = 0;
+  hills.terrain.numberOfHoles = 0;
+  hills.templates.length = 3.2;
+  hills.numberOfFrames = 20;
+  scenarios.push_back(hills);
+
+  Scenario urban;
+  urban.name = "urban";
+  urban.terrain.length = 12.8;
+  urban.terrain.resolution = 0.1;
+  urban.terrain.seed = 3;
+  urban.templates.length = 3.2;
+  urban.numberOfFrames = 20;
+  scenarios.push_back(urban);
+
+  Scenario noisy = urban;
+  noisy.name = "noisy";
+  noisy.templates.noise = 0.05;
+  noisy.templates.noisePerMeter = 0.02;
+  noisy.templates.numberOfOccludedSectors = 3;
+  scenarios.push_back(noisy);
+
+  // the prior differs from the ground truth, the estimate can not just stay at the prior
+  Scenario prior = urban;
+  prior.name = "prior";
+  prior.templates.priorPositionNoise = 0.3;
+  prior.templates.priorHeadingNoise = 3.0;
+  scenarios.push_back(prior);
+
+  // the prior is outside of the reference map, a failed metric can only be reinitialized globally
+  Scenario offset = urban;
+  offset.name = "offset";
+  offset.templates.priorOffsetX = urban.terrain.length;
+  scenarios.push_back(offset);
+
+  return scenarios;
+}
+
+static std::vector<Configuration> getConfigurations()
+{
+  std::vector<Configuration> configurations;
+
+  Configuration defaults;
+  defaults.name = "default";
+  defaults.parameters.verbose = false;
+  configurations.push_back(defaults);
+
+  Configuration fast = defaults;
+  fast.name = "fast";
+  fast.parameters.angleIncrement = 10;
+  fast.parameters.correlationIncrement = 8;
+  fast.parameters.numberOfParticles = 1000;
+  configurations.push_back(fast);
+
+  return configurations;
+}
+
+static double headingDifference(double a, double b)
+{
+  return std::fabs(std::remainder(a - b, 360.0));
+}
+
+/*!
+ * Matches the template stream of a scenario with one metric enabled, so the processor time is that of the metric.
+ */
+static RegressionResult runScenario(const Scenario& scenario, const Configuration& configuration, const std::string& metric,
+                                    const RegressionOptions& options, std::ostream* frameCsv)
+{
+  MapFitterParameters parameters = configuration.parameters;
+  parameters.SAD = metric == "SAD";
+  parameters.SSD = metric == "SSD";
+  parameters.NCC = metric == "NCC";
+  parameters.MI = metric == "MI";
+
+  TerrainGenerator generator(scenario.terrain, scenario.templates);
+  MapFitterCore core(parameters);
+  core.setReferenceMap(generator.getReferenceMap());
+
+  RegressionResult result;
+  result.scenario = scenario.name;
+  result.configuration = configuration.name;
+  result.metric = metric;
+  int successes = 0;
+  for (int frame = 0; frame < scenario.numberOfFrames; frame++)
+  {
+    SyntheticFrame syntheticFrame = generator.generateFrame(frame);
+    std::vector<MatchEstimate> estimates;
+
+    std::clock_t cpuStart = std::clock();
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    core.match(syntheticFrame.map, syntheticFrame.prior, estimates);
+    double cpuTime = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    result.cpuTime += cpuTime;
+    result.wallTime += wallTime;
+    result.frames += 1;
+
+    for (const MatchEstimate& estimate : estimates)
+    {
+      if (estimate.metric != metric) { continue; }
+      const PriorPose& truth = syntheticFrame.groundTruth;
+      double positionError = std::hypot(estimate.x - truth.x, estimate.y - truth.y);
+      double headingError = headingDifference(estimate.theta, truth.yaw / M_PI * 180.0);
+      bool success = estimate.valid && positionError < options.successDistance && headingError < options.successAngle;
+      if (estimate.valid)
+      {
+        result.valid += 1;
+        result.positionError += positionError;
+        result.headingError += headingError;
+      }
+      if (success) { successes += 1; }
+      if (frameCsv)
+      {
+        *frameCsv << scenario.name << "," << configuration.name << "," << metric << "," << frame << "," << estimate.valid << ","
+                  << estimate.x << "," << estimate.y << "," << estimate.theta << "," << truth.x << "," << truth.y << "," << truth.yaw / M_PI * 180.0 << ","
+                  << positionError << "," << headingError << "," << success << "," << cpuTime << "," << wallTime << std::endl;
+      }
+    }
+  }
+  if (result.valid > 0)
+  {
+    result.positionError /= result.valid;
+    result.headingError /= result.valid;
+  }
+  if (result.frames > 0)
+  {
+    result.successRate = double(successes) / result.frames;
+    result.cpuTime /= result.frames;
+    result.wallTime /= result.frames;
+  }
+  return result;
+}
+
+static const char* summaryHeader = "scenario,configuration,metric,frames,valid,success_rate,position_error,heading_error,cpu_time,wall_time";
+
+static void writeSummary(std::ostream& stream, const std::vector<RegressionResult>& results)
+{
+  stream << summaryHeader << std::endl;
+  for (const RegressionResult& result : results)
+  {
+    stream << result.scenario << "," << result.configuration << "," << result.metric << "," << result.frames << "," << result.valid << ","
+           << result.successRate << "," << result.positionError << "," << result.headingError << "," << result.cpuTime << "," << result.wallTime << std::endl;
+  }
+}
+
+static bool readBaseline(const std::string& path, std::map<std::string, RegressionResult>& baseline)
+{
+  std::ifstream file(path);
+  if (!file)
+  {
+    std::cerr << "Could not open the baseline " << path << "." << std::endl;
+    return false;
+  }
+  std::string line;
+  std::getline(file, line);
+  while (std::getline(file, line))
+  {
+    if (line.empty()) { continue; }
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream stream(line);
+    RegressionResult result;
+    if (!(stream >> result.scenario >> result.configuration >> result.metric >> result.frames >> result.valid >> result.successRate
+                 >> result.positionError >> result.headingError >> result.cpuTime >> result.wallTime))
+    {
+      std::cerr << "Invalid line in the baseline " << path << ": " << line << std::endl;
+      return false;
+    }
+    baseline[result.key()] = result;
+  }
+  return true;
+}
+
+/*!
+ * Compares the results with the baseline.
+ * @return false if the accuracy changed or the processor time increased beyond the tolerances.
+ */
+static bool compareWithBaseline(const std::vector<RegressionResult>& results, const std::map<std::string, RegressionResult>& baseline,
+                                const RegressionOptions& options)
+{
+  bool passed = true;
+  for (const RegressionResult& result : results)
+  {
+    std::map<std::string, RegressionResult>::const_iterator reference = baseline.find(result.key());
+    if (reference == baseline.end())
+    {
+      std::cout << "  " << result.key() << ": not in the baseline" << std::endl;
+      passed = false;
+      continue;
+    }
+    const RegressionResult& expected = reference->second;
+    std::vector<std::string> flags;
+    bool compareAccuracy = std::find(options.timingOnlyMetrics.begin(), options.timingOnlyMetrics.end(), result.metric) == options.timingOnlyMetrics.end();
+    if (compareAccuracy && std::fabs(result.successRate - expected.successRate) > options.successRateTolerance) { flags.push_back("success rate changed"); }
+    if (compareAccuracy && std::fabs(result.positionError - expected.positionError) > options.positionErrorTolerance) { flags.push_back("position error changed"); }
+    if (compareAccuracy && std::fabs(result.headingError - expected.headingError) > options.headingErrorTolerance) { flags.push_back("heading error changed"); }
+    if (options.timeTolerance >= 0 && result.cpuTime > expected.cpuTime * (1.0 + options.timeTolerance)) { flags.push_back("slower"); }
+
+    std::cout << "  " << std::left << std::setw(24) << result.key() << std::right
+              << " success " << expected.successRate << " -> " << result.successRate
+              << ", position error " << expected.positionError << " -> " << result.positionError << " m"
+              << ", heading error " << expected.headingError << " -> " << result.headingError << " deg"
+              << ", cpu " << expected.cpuTime << " -> " << result.cpuTime << " s";
+    if (!compareAccuracy) { std::cout << " (accuracy not compared)"; }
+    for (const std::string& flag : flags) { std::cout << " [" << flag << "]"; }
+    std::cout << std::endl;
+    if (!flags.empty()) { passed = false; }
+  }
+  return passed;
+}
+
+static void printUsage()
+{
+  std::cout << "Usage: map_fitter_regression [options]\n"
+            << "  Matches fixed synthetic scenarios with each metric and configuration and compares the\n"
+            << "  success rate, position and heading error and processor time per frame with a baseline.\n"
+            << "Options:\n"
+            << "  --scenario <name>              run only this scenario (hills, urban, noisy, prior, offset), repeatable\n"
+            << "  --baseline <file>              compare with the baseline, exit code 1 if a result is flagged\n"
+            << "  --write-baseline <file>        write the results as new baseline\n"
+            << "  --output <directory>           write regression_frames.csv and regression_summary.csv\n"
+            << "  --success-distance <m>         position error of a successful match (default 0.5)\n"
+            << "  --success-angle <deg>          heading error of a successful match (default 5)\n"
+            << "  --success-rate-tolerance <r>   allowed change of the success rate (default 0.05)\n"
+            << "  --position-tolerance <m>       allowed change of the mean position error (default 0.1)\n"
+            << "  --heading-tolerance <deg>      allowed change of the mean heading error (default 1)\n"
+            << "  --time-tolerance <fraction>    allowed increase of the processor time (default 0.3, negative to ignore)\n"
+            << "  --repetitions <n>              runs of each scenario, the fastest is kept (default 3)\n"
+            << "  --compare-accuracy-of-all      also compare the accuracy of MI, which does not localize in any scenario" << std::endl;
+}
+
+static bool parseArguments(int argc, char** argv, RegressionOptions& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string argument = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (argument == "--help") { return false; }
+    else if (argument == "--scenario" && hasValue) { options.scenarios.push_back(argv[++i]); }
+    else if (argument == "--baseline" && hasValue) { options.baselinePath = argv[++i]; }
+    else if (argument == "--write-baseline" && hasValue) { options.writeBaselinePath = argv[++i]; }
+    else if (argument == "--output" && hasValue) { options.outputDirectory = argv[++i]; }
+    else if (argument == "--success-distance" && hasValue) { options.successDistance = atof(argv[++i]); }
+    else if (argument == "--success-angle" && hasValue) { options.successAngle = atof(argv[++i]); }
+    else if (argument == "--success-rate-tolerance" && hasValue) { options.successRateTolerance = atof(argv[++i]); }
+    else if (argument == "--position-tolerance" && hasValue) { options.positionErrorTolerance = atof(argv[++i]); }
+    else if (argument == "--heading-tolerance" && hasValue) { options.headingErrorTolerance = atof(argv[++i]); }
+    else if (argument == "--time-tolerance" && hasValue) { options.timeTolerance = atof(argv[++i]); }
+    else if (argument == "--repetitions" && hasValue) { options.repetitions = std::max(1, atoi(argv[++i])); }
+    else if (argument == "--compare-accuracy-of-all") { options.timingOnlyMetrics.clear(); }
+    else
+    {
+      std::cerr << "Unknown option '" << argument << "'." << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} /* namespace */
+
+int main(int argc, char** argv)
+{
+  map_fitter::RegressionOptions options;
+  if (!map_fitter::parseArguments(argc, argv, options))
+  {
+    map_fitter::printUsage();
+    return 1;
+  }
+
+  std::map<std::string, map_fitter::RegressionResult> baseline;
+  if (!options.baselinePath.empty() && !map_fitter::readBaseline(options.baselinePath, baseline)) { return 1; }
+
+  std::ofstream frameCsv;
+  if (!options.outputDirectory.empty())
+  {
+    frameCsv.open(options.outputDirectory + "/regression_frames.csv");
+    if (!frameCsv)
+    {
+      std::cerr << "Could not write " << options.outputDirectory << "/regression_frames.csv." << std::endl;
+      return 1;
+    }
+    frameCsv << "scenario,configuration,metric,frame,valid,x,y,theta,truth_x,truth_y,truth_theta,position_error,heading_error,success,cpu_time,wall_time" << std::endl;
+  }
+
+  // the runs are sequential, the scoring is too, only the initialization of the particles runs on the thread pool,
+  // whose threads are included in the processor time
+  std::vector<map_fitter::RegressionResult> results;
+  for (const map_fitter::Scenario& scenario : map_fitter::getScenarios())
+  {
+    if (!options.scenarios.empty() && std::find(options.scenarios.begin(), options.scenarios.end(), scenario.name) == options.scenarios.end()) { continue; }
+    for (const map_fitter::Configuration& configuration : map_fitter::getConfigurations())
+    {
+      for (const char* metric : {"SAD", "SSD", "NCC", "MI"})
+      {
+        // the matching is deterministic, repetitions only reduce the timing noise
+        map_fitter::RegressionResult result = map_fitter::runScenario(scenario, configuration, metric, options, frameCsv.is_open() ? &frameCsv : nullptr);
+        for (int i = 1; i < options.repetitions; i++)
+        {
+          map_fitter::RegressionResult repetition = map_fitter::runScenario(scenario, configuration, metric, options, nullptr);
+          result.cpuTime = std::min(result.cpuTime, repetition.cpuTime);
+          result.wallTime = std::min(result.wallTime, repetition.wallTime);
+        }
+        results.push_back(result);
+        std::cout << result.key() << ": success " << result.successRate << ", position error " << result.positionError << " m, heading error "
+                  << result.headingError << " deg, " << result.cpuTime << " s cpu / " << result.wallTime << " s wall per frame" << std::endl;
+      }
+    }
+  }
+  if (results.empty())
+  {
+    std::cerr << "No scenario selected." << std::endl;
+    return 1;
+  }
+
+  if (!options.outputDirectory.empty())
+  {
+    std::ofstream summary(options.outputDirectory + "/regression_summary.csv");
+    map_fitter::writeSummary(summary, results);
+  }
+  if (!options.writeBaselinePath.empty())
+  {
+    std::ofstream file(options.writeBaselinePath);
+    if (!file)
+    {
+      std::cerr << "Could not write the baseline " << options.writeBaselinePath << "." << std::endl;
+      return 1;
+    }
+    map_fitter::writeSummary(file, results);
+  }
+
+  if (!baseline.empty())
+  {
+    std::cout << "Comparison with " << options.baselinePath << ":" << std::endl;
+    bool passed = map_fitter::compareWithBaseline(results, baseline, options);
+    std::cout << (passed ? "No regression." : "Regression: results changed beyond the tolerances.") << std::endl;
+    return passed ? 0 : 1;
+  }
+  return 0;
+}
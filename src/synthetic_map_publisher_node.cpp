@@ -0,0 +1,21 @@
+/*
+ * synthetic_map_publisher_node.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: hajungong007
+ *
+ */
+
+#include <ros/ros.h>
+#include <map_fitter/SyntheticMapPublisher.h>
+
+int main(int argc, char** argv) {
+
+  ros::init(argc, argv, "synthetic_map_publisher");
+  ros::NodeHandle nodeHandle("~");
+
+  map_fitter::SyntheticMapPublisher syntheticMapPublisher(nodeHandle);
+
+  ros::spin();
+  return 0;
+}